@@ -0,0 +1,183 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+/*
+ * Vergleicht das Durchfahren eines Gleisrings über das Node-Interface (ein virtueller
+ * Aufruf je Knoten, Nachbarn als NodePtr) mit der NodeGraph-Arena (Übergangstabelle
+ * je Knotenart, Nachbarn als Index). Der Ring besteht abwechselnd aus Blöcken und
+ * einfachen Weichen, die Weichen stehen auf geradeaus, der abzweigende Strang ist offen.
+ *
+ * Aufruf: bench-nodedispatch [Knotenpaare] [Schritte]
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "moba/node_block.h"
+#include "moba/node_simpleswitch.h"
+#include "moba/nodegraph.h"
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Result {
+        double        nsPerStep;
+        std::uint64_t checksum;
+    };
+
+    std::vector<NodePtr> createNodeRing(std::size_t pairs) {
+        std::vector<NodePtr> nodes;
+        nodes.reserve(pairs * 2);
+
+        for(std::size_t i = 0; i < pairs; ++i) {
+            nodes.push_back(std::make_shared<Block>(static_cast<unsigned int>(i * 2)));
+            nodes.push_back(std::make_shared<SimpleSwitch>(static_cast<unsigned int>(i * 2 + 1)));
+        }
+        for(std::size_t i = 0; i < pairs; ++i) {
+            const auto &block = nodes[i * 2];
+            const auto &sw = nodes[i * 2 + 1];
+            const auto &next = nodes[(i * 2 + 2) % nodes.size()];
+
+            block->setJunctionNode(Direction::RIGHT, sw);
+            sw->setJunctionNode(Direction::BOTTOM, block);
+            sw->setJunctionNode(Direction::TOP, next);
+            next->setJunctionNode(Direction::LEFT, sw);
+        }
+        return nodes;
+    }
+
+    void unlinkNodeRing(std::vector<NodePtr> &nodes) {
+        for(std::size_t i = 0; i < nodes.size(); i += 2) {
+            nodes[i]->setJunctionNode(Direction::LEFT, NodePtr{});
+            nodes[i]->setJunctionNode(Direction::RIGHT, NodePtr{});
+            nodes[i + 1]->setJunctionNode(Direction::BOTTOM, NodePtr{});
+            nodes[i + 1]->setJunctionNode(Direction::TOP, NodePtr{});
+        }
+    }
+
+    NodeGraph createGraphRing(std::size_t pairs) {
+        NodeGraph graph;
+        graph.reserve(pairs * 2);
+
+        for(std::size_t i = 0; i < pairs; ++i) {
+            graph.addNode(NodeKind::BLOCK, static_cast<unsigned int>(i * 2));
+            graph.addNode(NodeKind::SIMPLE_SWITCH, static_cast<unsigned int>(i * 2 + 1));
+        }
+        for(std::size_t i = 0; i < pairs; ++i) {
+            const auto block = static_cast<NodeId>(i * 2);
+            const auto next = static_cast<NodeId>((i * 2 + 2) % (pairs * 2));
+
+            graph.connect(block, Direction{Direction::RIGHT}, block + 1, Direction{Direction::BOTTOM});
+            graph.connect(block + 1, Direction{Direction::TOP}, next, Direction{Direction::LEFT});
+        }
+        return graph;
+    }
+
+    Result runVirtual(const std::vector<NodePtr> &nodes, std::size_t steps) {
+        NodePtr prev = nodes.back();
+        NodePtr cur = nodes.front();
+        std::uint64_t checksum = 0;
+
+        const auto start = Clock::now();
+        for(std::size_t i = 0; i < steps; ++i) {
+            auto next = cur->getJunctionNode(prev);
+            prev = std::move(cur);
+            cur = std::move(next);
+            checksum += cur->getId();
+        }
+        const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+        return {elapsed.count() / static_cast<double>(steps), checksum};
+    }
+
+    Result runArena(const NodeGraph &graph, std::size_t steps) {
+        NodeGraph::Step cur{0, 0};
+        std::uint64_t checksum = 0;
+
+        const auto start = Clock::now();
+        for(std::size_t i = 0; i < steps; ++i) {
+            cur = *graph.findNext(cur.node, cur.entry);
+            checksum += graph.getId(cur.node);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+        return {elapsed.count() / static_cast<double>(steps), checksum};
+    }
+
+    Result runAdapter(const NodeGraph &graph, std::size_t steps) {
+        NodePtr prev = graph.getNode(static_cast<NodeId>(graph.size() - 1));
+        NodePtr cur = graph.getNode(0);
+        std::uint64_t checksum = 0;
+
+        const auto start = Clock::now();
+        for(std::size_t i = 0; i < steps; ++i) {
+            auto next = cur->getJunctionNode(prev);
+            prev = std::move(cur);
+            cur = std::move(next);
+            checksum += cur->getId();
+        }
+        const std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+        return {elapsed.count() / static_cast<double>(steps), checksum};
+    }
+
+    void print(const char *name, const Result &result, const Result &baseline) {
+        std::cout <<
+            name << ": " << result.nsPerStep << " ns/step (" <<
+            baseline.nsPerStep / result.nsPerStep << "x), checksum " << result.checksum << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const std::size_t pairs = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    const std::size_t steps = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20000000;
+
+    if(pairs == 0 || steps == 0) {
+        std::cerr << "usage: " << argv[0] << " [pairs] [steps]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto nodes = createNodeRing(pairs);
+    const auto graph = createGraphRing(pairs);
+
+    std::cout << pairs * 2 << " nodes, " << steps << " steps" << std::endl;
+
+    // je einmal vorab, damit beide Varianten mit warmem Cache starten
+    runVirtual(nodes, pairs * 2);
+    runArena(graph, pairs * 2);
+
+    const auto virtualResult = runVirtual(nodes, steps);
+    const auto arenaResult = runArena(graph, steps);
+    const auto adapterResult = runAdapter(graph, steps);
+
+    print("Node (virtual)   ", virtualResult, virtualResult);
+    print("NodeGraph (arena)", arenaResult, virtualResult);
+    print("NodeGraph adapter", adapterResult, virtualResult);
+
+    unlinkNodeRing(nodes);
+
+    if(virtualResult.checksum != arenaResult.checksum || virtualResult.checksum != adapterResult.checksum) {
+        std::cerr << "traversals differ" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+#include "position.h"
+
+/**
+ * Hält die exakte Ausdehnung (kleinste und größte belegte Position) einer Menge von
+ * Zellen. Dazu wird pro belegter Zeile und pro belegter Spalte die Anzahl der Zellen
+ * gezählt; beim Entfernen der letzten Zelle einer Randzeile bzw. -spalte ergibt sich die
+ * neue Grenze aus dem nächsten Zähler, nie aus den Zellen selbst. Die Zähler sind dünn
+ * besetzt, der Speicherbedarf hängt daher nur von der Anzahl der belegten Zeilen und
+ * Spalten ab, nicht von der Größe des überdeckten Koordinatenbereichs. Abfragen kosten
+ * O(1), Einfügen und Entfernen O(log n).
+ */
+class Bounds {
+public:
+    Bounds() = default;
+
+    /**
+     * Feste Ausdehnung ohne Zähler, z.B. für Nur-Lese-Speicherstrategien
+     */
+    Bounds(const Position &min, const Position &max): columns{min.x, max.x}, rows{min.y, max.y} {
+    }
+
+    void add(const Position &pos) {
+        columns.add(pos.x);
+        rows.add(pos.y);
+    }
+
+    void remove(const Position &pos) {
+        columns.remove(pos.x);
+        rows.remove(pos.y);
+    }
+
+    [[nodiscard]] Position getMin() const {
+        return {columns.min, rows.min};
+    }
+
+    [[nodiscard]] Position getMax() const {
+        return {columns.max, rows.max};
+    }
+
+protected:
+    struct Axis {
+        Axis() = default;
+
+        Axis(std::size_t min, std::size_t max): min{min}, max{max} {
+        }
+
+        void add(std::size_t v) {
+            ++counts[v];
+            min = counts.begin()->first;
+            max = counts.rbegin()->first;
+        }
+
+        void remove(std::size_t v) {
+            auto iter = counts.find(v);
+            if(iter == counts.end()) {
+                return;
+            }
+            if(!--iter->second) {
+                counts.erase(iter);
+            }
+            if(counts.empty()) {
+                min = max = 0;
+                return;
+            }
+            min = counts.begin()->first;
+            max = counts.rbegin()->first;
+        }
+
+        std::map<std::size_t, std::uint32_t> counts; // Koordinate -> Anzahl belegter Zellen
+        std::size_t min = 0;
+        std::size_t max = 0;
+    };
+
+    Axis columns;
+    Axis rows;
+};
@@ -0,0 +1,147 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#include "connectivityvalidator.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace {
+
+    // die vier Richtungen, die jeweils mit der Gegenrichtung der Nachbarzelle verglichen werden
+    constexpr std::array<Direction::Position, 4> forwardDirections = {
+        Direction::RIGHT, Direction::BOTTOM_RIGHT, Direction::BOTTOM, Direction::BOTTOM_LEFT
+    };
+
+    std::size_t getPlaneIndex(Direction dir) {
+        return std::countr_zero(static_cast<std::uint8_t>(dir));
+    }
+
+    /**
+     * Liefert Wort w einer Zeile, deren Bits um dx Spalten verschoben sind, d.h. Bit x
+     * des Ergebnisses entspricht Spalte x + dx
+     */
+    std::uint64_t getShiftedWord(const std::uint64_t *row, std::size_t words, std::size_t w, int dx) {
+        switch(dx) {
+            case 1:
+                return row[w] >> 1 | (w + 1 < words ? row[w + 1] << 63 : 0);
+
+            case -1:
+                return row[w] << 1 | (w ? row[w - 1] >> 63 : 0);
+
+            default:
+                return row[w];
+        }
+    }
+}
+
+JunctionPlanes::JunctionPlanes(const Position &min, std::size_t width, std::size_t height):
+min{min}, width{width + 2}, height{height + 2}, words{(width + 2 + 63) / 64} {
+    for(auto &plane: planes) {
+        plane.resize(words * this->height);
+    }
+    occupied.resize(words * this->height);
+}
+
+void JunctionPlanes::set(const Position &pos, std::uint8_t junctions) {
+    const auto col = pos.x - min.x + 1;
+    const auto row = pos.y - min.y + 1;
+
+    if(pos.x < min.x || pos.y < min.y || col + 1 >= width || row + 1 >= height) {
+        throw std::out_of_range{"position out of range"};
+    }
+
+    const auto idx = row * words + col / 64;
+    const auto bit = std::uint64_t{1} << (col % 64);
+
+    for(auto b = junctions; b; b &= b - 1) {
+        planes[std::countr_zero(b)][idx] |= bit;
+    }
+    if(junctions) {
+        occupied[idx] |= bit;
+    }
+}
+
+std::vector<JunctionError> JunctionPlanes::validate(unsigned int threads) const {
+    // Zeile row wird mit row + 1 verglichen, die letzte Randzeile hat keine Nachbarzeile
+    const auto rows = height - 1;
+    const auto count = std::clamp<std::size_t>(threads, 1, rows);
+    const auto chunk = (rows + count - 1) / count;
+
+    std::vector<std::vector<JunctionError>> results(count);
+    {
+        std::vector<std::jthread> pool;
+        pool.reserve(count - 1);
+        for(std::size_t i = 1; i < count; ++i) {
+            pool.emplace_back([this, i, chunk, rows, &results] {
+                validateRows(i * chunk, std::min(rows, (i + 1) * chunk), results[i]);
+            });
+        }
+        validateRows(0, std::min(rows, chunk), results[0]);
+    }
+
+    std::vector<JunctionError> errors;
+    for(auto &part: results) {
+        errors.insert(errors.end(), part.begin(), part.end());
+    }
+    std::sort(errors.begin(), errors.end());
+    return errors;
+}
+
+void JunctionPlanes::validateRows(std::size_t first, std::size_t last, std::vector<JunctionError> &errors) const {
+    auto report = [&](std::size_t col, std::size_t row, Direction dir, std::size_t nCol, std::size_t nRow) {
+        errors.push_back({
+            {col + min.x - 1, row + min.y - 1},
+            dir,
+            isSet(occupied, nCol, nRow) ? JunctionError::MISMATCHED : JunctionError::DANGLING
+        });
+    };
+
+    for(const auto d: forwardDirections) {
+        const Direction dir{d};
+        const Direction opposite = dir.getComplementaryDirection();
+        const auto delta = dir.getDelta();
+
+        const auto &plane = planes[getPlaneIndex(dir)];
+        const auto &counter = planes[getPlaneIndex(opposite)];
+
+        for(auto row = first; row < last; ++row) {
+            const auto *cur = plane.data() + row * words;
+            const auto *next = counter.data() + (row + delta.y) * words;
+
+            for(std::size_t w = 0; w < words; ++w) {
+                auto diff = cur[w] ^ getShiftedWord(next, words, w, delta.x);
+
+                for(; diff; diff &= diff - 1) {
+                    const auto col = w * 64 + std::countr_zero(diff);
+                    const auto nCol = col + delta.x;
+                    const auto nRow = row + delta.y;
+
+                    if(isSet(plane, col, row)) {
+                        report(col, row, dir, nCol, nRow);
+                    } else {
+                        report(nCol, nRow, opposite, col, row);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,125 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "container.h"
+#include "direction.h"
+#include "position.h"
+#include "symbol.h"
+
+/**
+ * Verbindungspunkt dir der Zelle pos ohne passenden Gegenanschluss
+ */
+struct JunctionError {
+    enum Kind {
+        DANGLING   = 1, // Nachbarzelle leer bzw. außerhalb des Rasters
+        MISMATCHED = 2  // Nachbarzelle belegt, aber ohne komplementären Anschluss
+    };
+
+    Position  pos;
+    Direction dir;
+    Kind      kind;
+
+    friend bool operator<(const JunctionError &lhs, const JunctionError &rhs) {
+        if(lhs.pos != rhs.pos) {
+            return lhs.pos < rhs.pos;
+        }
+        return static_cast<int>(lhs.dir) < static_cast<int>(rhs.dir);
+    }
+};
+
+/**
+ * Gleisplan als 8 Bitebenen, eine je Richtung (ein Bit je Zelle und Anschluss). Um das
+ * Raster liegt ein leerer Rand von einer Zelle, damit auch Anschlüsse am Rand ohne
+ * Sonderfall geprüft werden.
+ *
+ * validate vergleicht für die vier Richtungen RIGHT, BOTTOM_RIGHT, BOTTOM und BOTTOM_LEFT
+ * jede Zeile wortweise per XOR mit der um eine Spalte verschobenen Ebene der Gegenrichtung
+ * in der Nachbarzeile. Jedes gesetzte Bit ist ein Anschluss ohne Gegenstück, entweder auf
+ * dieser oder auf der Nachbarseite. Die Zeilen werden auf mehrere Threads verteilt.
+ */
+class JunctionPlanes {
+public:
+    /**
+     * @param min linke obere Ecke des Rasters
+     * @param width Anzahl Spalten
+     * @param height Anzahl Zeilen
+     */
+    JunctionPlanes(const Position &min, std::size_t width, std::size_t height);
+
+    template<typename Storage>
+    static JunctionPlanes fromContainer(const Container<Symbol, Storage> &layout) {
+        if(!layout.itemsCount()) {
+            return {{}, 0, 0};
+        }
+        const auto min = layout.getMinPosition();
+        const auto max = layout.getMaxPosition();
+
+        JunctionPlanes planes{min, max.x - min.x + 1, max.y - min.y + 1};
+        for(const auto &[pos, symbol]: layout.getViewport()) {
+            planes.set(pos, symbol.getType());
+        }
+        return planes;
+    }
+
+    /**
+     * Setzt die Anschlüsse junctions (z.B. Symbol::getType()) der Zelle pos
+     */
+    void set(const Position &pos, std::uint8_t junctions);
+
+    /**
+     * Liefert alle Anschlüsse ohne Gegenstück, sortiert nach Position und Richtung
+     */
+    [[nodiscard]] std::vector<JunctionError> validate(
+        unsigned int threads = std::thread::hardware_concurrency()
+    ) const;
+
+protected:
+    Position    min;
+    std::size_t width;  // inklusive Rand
+    std::size_t height; // inklusive Rand
+    std::size_t words;  // Worte je Zeile
+
+    std::array<std::vector<std::uint64_t>, 8> planes; // indiziert über die Bitnummer der Richtung
+    std::vector<std::uint64_t> occupied;
+
+    [[nodiscard]] bool isSet(const std::vector<std::uint64_t> &plane, std::size_t col, std::size_t row) const {
+        return plane[row * words + col / 64] >> (col % 64) & 1;
+    }
+
+    void validateRows(std::size_t first, std::size_t last, std::vector<JunctionError> &errors) const;
+};
+
+/**
+ * Prüft sämtliche Anschlüsse des Gleisplans, ohne den Knotengraphen aufzubauen
+ */
+template<typename Storage>
+std::vector<JunctionError> validateConnectivity(
+    const Container<Symbol, Storage> &layout, unsigned int threads = std::thread::hardware_concurrency()
+) {
+    return JunctionPlanes::fromContainer(layout).validate(threads);
+}
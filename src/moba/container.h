@@ -20,14 +20,27 @@
 
 #pragma once
 
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
 #include <exception>
 #include <string>
-#include <map>
 #include <memory>
 #include <functional>
+#include <iterator>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
 
+#include "bounds.h"
 #include "position.h"
 #include "symbol.h"
+#include "storage_map.h"
+#include "storage_dense.h"
+#include "storage_tiled.h"
+#include "storage_morton.h"
 
 class ContainerException: public std::exception {
 
@@ -47,49 +60,289 @@ public:
     }
 };
 
+/**
+ * Ergebnis von Container::getNeighbours: die Nachbarzellen einer Position, indiziert
+ * über die Bitnummer der jeweiligen Richtung
+ */
 template<typename T>
+struct Neighbourhood {
+    std::array<T, 8> items;
+    std::uint8_t mask = 0; // Bit gesetzt -> Nachbar in dieser Richtung vorhanden
+
+    [[nodiscard]] bool has(Direction dir) const {
+        return mask & static_cast<std::uint8_t>(dir);
+    }
+
+    const T &get(Direction dir) const {
+        return items[std::countr_zero(static_cast<std::uint8_t>(dir))];
+    }
+};
+
+/**
+ * Sicht auf alle belegten Zellen eines Rechtecks (from / to jeweils einschließlich).
+ * Die Iteration liefert Paare aus Position und Element zeilenweise sortiert und
+ * kommt ohne Speicheranforderung aus.
+ */
+template<typename T, typename Storage>
+class Viewport {
+public:
+    class Iterator {
+    public:
+        using value_type = std::pair<Position, T>;
+        using reference = std::pair<Position, const T&>;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+
+        Iterator(const Storage *storage, const Position &from, const Position &to):
+        storage{storage}, from{from}, to{to}, pos{from} {
+            item = storage->findNext(pos, from, to);
+        }
+
+        reference operator*() const {
+            return {pos, *item};
+        }
+
+        Iterator& operator++() {
+            if(pos.x < to.x) {
+                ++pos.x;
+            } else {
+                pos = {from.x, pos.y + 1};
+            }
+            item = storage->findNext(pos, from, to);
+            return *this;
+        }
+
+        void operator++(int) {
+            operator++();
+        }
+
+        friend bool operator==(const Iterator &iter, std::default_sentinel_t) {
+            return !iter.item;
+        }
+
+    protected:
+        const Storage *storage = nullptr;
+        Position from;
+        Position to;
+        Position pos;
+        decltype(std::declval<const Storage&>().find(Position{})) item{};
+    };
+
+    Viewport(const Storage &storage, const Position &from, const Position &to):
+    storage{storage}, from{from}, to{to} {
+    }
+
+    Iterator begin() const {
+        return {&storage, from, to};
+    }
+
+    std::default_sentinel_t end() const {
+        return {};
+    }
+
+protected:
+    const Storage &storage;
+    Position from;
+    Position to;
+};
+
+/**
+ * Container für die Zellen eines Gleisplans. Die Ablage erfolgt über eine
+ * austauschbare Speicherstrategie (siehe MapStorage, DenseStorage, TiledStorage,
+ * MortonStorage)
+ *
+ * Der Koordinatenbereich hängt von der Speicherstrategie ab. Mit der Standardstrategie
+ * MapStorage sind x und y auf 31 Bit (INT32_MAX) beschränkt, MortonStorage erlaubt 32 Bit,
+ * TiledStorage 32 + TileBits Bit. Positionen außerhalb werden beim Einfügen mit
+ * std::out_of_range abgewiesen, Abfragen und Entfernen behandeln sie als leere Zellen.
+ */
+template<typename T, typename Storage = MapStorage<T>>
 class Container {
 public:
     Container() = default;
 
+    /**
+     * Übernimmt eine bereits befüllte Speicherstrategie (z.B. MappedStorage)
+     */
+    Container(Storage storage, const Bounds &bounds):
+    bounds{bounds}, items{std::move(storage)} {
+    }
+
+    Container(const Container&) = default;
+    Container(Container&&) noexcept = default;
+
+    Container& operator=(const Container&) = default;
+    Container& operator=(Container&&) noexcept = default;
+
     virtual ~Container() noexcept = default;
 
     std::size_t getHeight() const {
-        return maxPosition.y;
+        return bounds.getMax().y;
     }
 
     std::size_t getWidth() const {
-        return maxPosition.x;
+        return bounds.getMax().x;
     }
 
+    /**
+     * Liefert die kleinste belegte Spalte bzw. Zeile
+     */
+    Position getMinPosition() const {
+        return bounds.getMin();
+    }
+
+    /**
+     * Liefert die größte belegte Spalte bzw. Zeile
+     */
+    Position getMaxPosition() const {
+        return bounds.getMax();
+    }
+
+    /**
+     * Legt das Element an pos ab bzw. ersetzt ein vorhandenes
+     *
+     * @throws std::out_of_range wenn pos außerhalb des Koordinatenbereichs der
+     *         Speicherstrategie liegt (MapStorage: x oder y größer als INT32_MAX)
+     */
     void addItem(const Position &pos, T item) {
-        items[pos] = item;
-        maxPosition.grow(pos);
+        if(items.addItem(pos, std::move(item))) {
+            bounds.add(pos);
+        }
     }
 
-    T get(const Position &pos) {
-        auto iter = items.find(pos);
+    /**
+     * Ersetzt das Element an pos bzw. legt es neu an
+     *
+     * @return std::optional<T> das bisherige Element oder std::nullopt, wenn die Zelle leer war
+     * @throws std::out_of_range wie addItem
+     */
+    std::optional<T> replaceItem(const Position &pos, T item) {
+        if(auto old = items.find(pos)) {
+            return std::exchange(*old, std::move(item));
+        }
+        addItem(pos, std::move(item));
+        return std::nullopt;
+    }
+
+    /**
+     * Entfernt das Element an pos. Die Ausdehnung (getWidth, getHeight, getMinPosition)
+     * wird dabei exakt nachgeführt.
+     *
+     * @return bool false, wenn die Zelle bereits leer war
+     */
+    bool removeItem(const Position &pos) {
+        if(!items.removeItem(pos)) {
+            return false;
+        }
+        bounds.remove(pos);
+        return true;
+    }
+
+    /**
+     * Fügt einen ganzen Bereich von (Position, T)-Paaren ein. Bei Forward-Ranges wird der
+     * Speicher vorab dimensioniert. Verschoben statt kopiert wird nur, wenn der Bereich
+     * R-Werte liefert (z.B. std::views::as_rvalue) oder ein besitzender Container (keine
+     * View) als R-Wert übergeben wird; Views auf fremde Container bleiben unangetastet.
+     * Zeilenweise sortierte Eingaben werden von MapStorage ohne Suche angehängt.
+     *
+     * @throws std::out_of_range wie addItem; bereits eingefügte Elemente bleiben erhalten
+     */
+    template<std::ranges::input_range R>
+    void addItems(R &&range) {
+        if constexpr(std::ranges::forward_range<R>) {
+            std::size_t count = 0;
+            auto maxPos = bounds.getMax();
+            for(const auto &[pos, item]: range) {
+                maxPos.grow(pos);
+                ++count;
+            }
+            items.reserve(count, maxPos);
+        }
+
+        constexpr bool movable =
+            !std::is_lvalue_reference_v<std::ranges::range_reference_t<R>> ||
+            (!std::is_lvalue_reference_v<R> && !std::ranges::view<std::remove_cvref_t<R>>);
 
-        if(iter == items.end()) {
+        for(auto &&[pos, item]: range) {
+            bool inserted;
+            if constexpr(movable) {
+                inserted = items.addItem(pos, std::move(item));
+            } else {
+                inserted = items.addItem(pos, item);
+            }
+            if(inserted) {
+                bounds.add(pos);
+            }
+        }
+    }
+
+    T get(const Position &pos) const {
+        auto item = tryGet(pos);
+
+        if(!item) {
             throw ContainerException{"no valid item"};
         }
-        return iter->second;
+        return std::move(*item);
+    }
+
+    /**
+     * Wie get, liefert bei einer leeren Zelle aber std::nullopt statt eine Exception zu werfen
+     */
+    std::optional<T> tryGet(const Position &pos) const {
+        auto item = items.find(pos);
+
+        if(!item) {
+            return std::nullopt;
+        }
+        return *item;
+    }
+
+    /**
+     * Liefert alle in directions (z.B. Symbol::getType()) gesetzten Nachbarn von pos in
+     * einem Aufruf. Die Nachbarpositionen entsprechen Position::step, d.h. am linken
+     * bzw. oberen Rand gibt es keine Nachbarn. Fehlende Nachbarn werden über die
+     * Bitmaske gemeldet statt per Exception.
+     */
+    Neighbourhood<T> getNeighbours(const Position &pos, std::uint8_t directions = 0xFF) const {
+        Neighbourhood<T> neighbourhood;
+        neighbourhood.mask = items.getNeighbours(pos, directions, neighbourhood.items);
+        return neighbourhood;
+    }
+
+    /**
+     * Liefert alle belegten Zellen innerhalb des Rechtecks from / to (jeweils
+     * einschließlich) in Zeilenreihenfolge, z.B. für den sichtbaren Ausschnitt eines Clients
+     */
+    Viewport<T, Storage> getViewport(const Position &from, const Position &to) const {
+        return {items, from, to};
+    }
+
+    /**
+     * Liefert alle belegten Zellen in Zeilenreihenfolge
+     */
+    Viewport<T, Storage> getViewport() const {
+        return {items, bounds.getMin(), bounds.getMax()};
     }
 
     std::size_t itemsCount() const {
-        return items.count();
+        return items.itemsCount();
     }
 
-    Position getNextBoundPosition() {
-        auto iter = items.begin();
+    Position getNextBoundPosition() const {
+        auto pos = tryGetNextBoundPosition();
 
-        if(iter == items.end()) {
+        if(!pos) {
             throw ContainerException{"No position found!"};
         }
-        return iter->first;
+        return *pos;
+    }
+
+    std::optional<Position> tryGetNextBoundPosition() const {
+        return items.getFirstPosition();
     }
 
 protected:
-    Position maxPosition = {0, 0};
-    std::map<Position, T> items;
+    Bounds bounds;
+    Storage items;
 };
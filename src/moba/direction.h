@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <bit>
 #include <string>
 #include <cstdint>
 #include <stdexcept>
@@ -42,11 +43,11 @@ struct Direction {
     constexpr Direction(): position{UNSET} {
     }
 
-    Direction(const Position position):
+    constexpr Direction(const Position position):
     position{static_cast<std::uint8_t>(position)} {
     }
 
-    Direction(std::uint8_t position) {
+    constexpr Direction(std::uint8_t position) {
         switch(position) {
             case UNSET:
             case TOP:
@@ -66,7 +67,7 @@ struct Direction {
         }
     }
 
-    static Direction getDirectionByArrowKeys(int key) {
+    static constexpr Direction getDirectionByArrowKeys(int key) {
         switch(key) {
             case 1:
                 return Direction::BOTTOM_LEFT;
@@ -91,50 +92,50 @@ struct Direction {
         }
     }
 
-    operator int() const {
+    constexpr operator int() const {
         return position;
     }
 
-    Direction& operator++() {
+    constexpr Direction& operator++() {
         position = position << 1 | position >> 7;
         return *this;
     }
 
-    Direction operator++(int) {
+    constexpr Direction operator++(int) {
         const Direction tmp(*this);
         operator++();
         return tmp;
     }
 
-    Direction& operator+=(std::uint8_t steps) {
+    constexpr Direction& operator+=(std::uint8_t steps) {
         steps &= 7;
         position = position << steps | position >> (-steps & 7);
         return *this;
     }
 
-    friend Direction operator+(Direction lhs, const std::uint8_t steps) {
+    friend constexpr Direction operator+(Direction lhs, const std::uint8_t steps) {
         lhs += steps;
         return lhs;
     }
 
-    Direction& operator--() {
+    constexpr Direction& operator--() {
         position = position >> 1 | position << 7;
         return *this;
     }
 
-    Direction operator--(int) {
+    constexpr Direction operator--(int) {
         const Direction tmp(*this);
         operator--();
         return tmp;
     }
 
-    Direction& operator-=(std::uint8_t steps) {
+    constexpr Direction& operator-=(std::uint8_t steps) {
         steps &= 7;
         position = position >> steps | position << (-steps & 7);
         return *this;
     }
 
-    friend Direction operator-(Direction lhs, const std::uint8_t steps) {
+    friend constexpr Direction operator-(Direction lhs, const std::uint8_t steps) {
         lhs -= steps;
         return lhs;
     }
@@ -192,7 +193,7 @@ struct Direction {
     * @return DistanceType
     */
     [[nodiscard]]
-    DistanceType getDistanceType(const Direction dirOut) const {
+    constexpr DistanceType getDistanceType(const Direction dirOut) const {
        auto dirInCom = getComplementaryDirection();
 
        if(dirOut == ++dirInCom) {
@@ -211,10 +212,35 @@ struct Direction {
     }
 
     [[nodiscard]]
-    Direction getComplementaryDirection() const {
+    constexpr Direction getComplementaryDirection() const {
         return position << 4 | position >> 4;
     }
 
+    struct Delta {
+        std::int8_t x;
+        std::int8_t y;
+    };
+
+    /**
+     * Liefert den Versatz (x, y) eines Schrittes in diese Richtung. Die Tabelle wird über
+     * die Bitnummer der Richtung indiziert, UNSET (Bitnummer 8) bewegt sich nicht.
+     */
+    [[nodiscard]]
+    constexpr Delta getDelta() const {
+        constexpr Delta deltas[] = {
+            { 0, -1}, // TOP
+            { 1, -1}, // TOP_RIGHT
+            { 1,  0}, // RIGHT
+            { 1,  1}, // BOTTOM_RIGHT
+            { 0,  1}, // BOTTOM
+            {-1,  1}, // BOTTOM_LEFT
+            {-1,  0}, // LEFT
+            {-1, -1}, // TOP_LEFT
+            { 0,  0}  // UNSET
+        };
+        return deltas[std::countr_zero(position)];
+    }
+
 protected:
     std::uint8_t position;
 
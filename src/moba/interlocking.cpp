@@ -0,0 +1,146 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#include "interlocking.h"
+
+#include <bit>
+
+namespace {
+
+    constexpr std::uint64_t lowNibbleBits = 0x1111111111111111ull;
+
+    /**
+     * Setzt alle vier Bits jeder Weiche (Halbbyte), in der mindestens ein Bit gesetzt ist
+     */
+    constexpr std::uint64_t getNibbles(std::uint64_t bits) {
+        return ((bits | bits >> 1 | bits >> 2 | bits >> 3) & lowNibbleBits) * 0xF;
+    }
+
+    std::uint64_t getWord(const std::vector<std::uint64_t> &bits, std::uint32_t index) {
+        return index < bits.size() ? bits[index] : 0;
+    }
+}
+
+Interlocking::Interlocking(std::size_t nodesCount):
+nodes((nodesCount + 63) / 64), stands((nodesCount * 4 + 63) / 64), standUsers(nodesCount) {
+}
+
+bool Interlocking::canSet(const Route &route) const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return isCompatible(route);
+}
+
+bool Interlocking::reserve(const Route &route) {
+    std::lock_guard<std::mutex> lock{mutex};
+    if(!isCompatible(route)) {
+        return false;
+    }
+    setBits(route.nodeBits, nodes);
+    addStands(route.standBits);
+    return true;
+}
+
+void Interlocking::release(const Route &route) {
+    std::lock_guard<std::mutex> lock{mutex};
+    if(!isSubset(route.nodeBits, nodes) || !isSubset(route.standBits, stands)) {
+        throw InterlockingException{"route is not set"};
+    }
+    clearBits(route.nodeBits, nodes);
+    removeStands(route.standBits);
+}
+
+bool Interlocking::isOccupied(NodeId node) const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return (getWord(nodes, node / 64) >> (node % 64) & 1) || (node < standUsers.size() && standUsers[node]);
+}
+
+std::optional<moba::SwitchStand> Interlocking::getDemandedStand(NodeId node) const {
+    std::lock_guard<std::mutex> lock{mutex};
+    const auto bit = std::uint64_t{node} * 4;
+    const auto nibble = getWord(stands, static_cast<std::uint32_t>(bit / 64)) >> (bit % 64) & 0xF;
+    if(!nibble) {
+        return std::nullopt;
+    }
+    return getRowState(std::countr_zero(nibble));
+}
+
+bool Interlocking::isCompatible(const Route &route) const {
+    for(const auto &word: route.nodeBits) {
+        if(getWord(nodes, word.index) & word.bits) {
+            return false;
+        }
+    }
+    // andere Stellung derselben Weiche gefordert: Bits im selben Halbbyte, aber nicht die eigenen
+    for(const auto &word: route.standBits) {
+        if(getWord(stands, word.index) & getNibbles(word.bits) & ~word.bits) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Interlocking::isSubset(const std::vector<BitWord> &words, const std::vector<std::uint64_t> &bits) {
+    for(const auto &word: words) {
+        if((getWord(bits, word.index) & word.bits) != word.bits) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Interlocking::setBits(const std::vector<BitWord> &words, std::vector<std::uint64_t> &bits) {
+    if(!words.empty() && words.back().index >= bits.size()) {
+        bits.resize(words.back().index + 1);
+    }
+    for(const auto &word: words) {
+        bits[word.index] |= word.bits;
+    }
+}
+
+void Interlocking::clearBits(const std::vector<BitWord> &words, std::vector<std::uint64_t> &bits) {
+    for(const auto &word: words) {
+        bits[word.index] &= ~word.bits;
+    }
+}
+
+void Interlocking::addStands(const std::vector<BitWord> &words) {
+    setBits(words, stands);
+    for(const auto &word: words) {
+        for(auto bits = word.bits; bits; bits &= bits - 1) {
+            const auto node = (std::size_t{word.index} * 64 + std::countr_zero(bits)) / 4;
+            if(node >= standUsers.size()) {
+                standUsers.resize(node + 1);
+            }
+            ++standUsers[node];
+        }
+    }
+}
+
+void Interlocking::removeStands(const std::vector<BitWord> &words) {
+    for(const auto &word: words) {
+        for(auto bits = word.bits; bits; bits &= bits - 1) {
+            const auto bit = std::countr_zero(bits);
+            // die Stellung bleibt gefordert, solange eine andere Fahrstraße die Weiche nutzt
+            if(!--standUsers[(std::size_t{word.index} * 64 + bit) / 4]) {
+                stands[word.index] &= ~(std::uint64_t{1} << bit);
+            }
+        }
+    }
+}
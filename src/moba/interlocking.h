@@ -0,0 +1,119 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include <moba-common/enumswitchstand.h>
+
+#include "nodegraph.h"
+#include "routefinder.h"
+
+class InterlockingException: public std::exception {
+
+    std::string what_;
+
+public:
+    explicit InterlockingException(const std::string &err) noexcept: what_{err} {
+    }
+
+    InterlockingException() noexcept: what_{"Unknown error"} {
+    }
+
+    virtual ~InterlockingException() noexcept = default;
+
+    virtual const char *what() const noexcept {
+        return this->what_.c_str();
+    }
+};
+
+/**
+ * Verschlusstabelle der eingestellten Fahrstraßen. Geführt werden zwei Bitmengen: die
+ * belegten Blöcke und die geforderten Weichenstellungen (je Weiche vier Bits, eines je
+ * Stellung, vgl. Route::standBits).
+ *
+ * Eine Fahrstraße ist verträglich, wenn sie keinen belegten Block enthält und keine
+ * ihrer Weichen von einer anderen Fahrstraße in einer anderen Stellung gefordert wird.
+ * Fordern mehrere Fahrstraßen dieselbe Stellung einer Weiche, teilen sie sich die
+ * Weiche; je Weiche wird mitgezählt, wie viele Fahrstraßen sie fordern. Die Prüfung
+ * läuft nur über die (wenigen) Worte der Fahrstraße, je Wort genügen einige
+ * UND-Verknüpfungen.
+ *
+ * reserve prüft und belegt in einem Schritt, release gibt wieder frei. Alle Methoden
+ * dürfen gleichzeitig aus mehreren Threads aufgerufen werden.
+ */
+class Interlocking {
+public:
+    explicit Interlocking(std::size_t nodesCount = 0);
+
+    /**
+     * true, wenn route mit allen eingestellten Fahrstraßen verträglich ist
+     */
+    [[nodiscard]] bool canSet(const Route &route) const;
+
+    /**
+     * Stellt route ein, sofern verträglich; andernfalls bleibt die Tabelle unverändert
+     *
+     * @return true, wenn route eingestellt wurde
+     */
+    bool reserve(const Route &route);
+
+    /**
+     * Löst eine zuvor mit reserve eingestellte Fahrstraße auf
+     */
+    void release(const Route &route);
+
+    /**
+     * true, wenn node ein belegter Block oder eine geforderte Weiche ist
+     */
+    [[nodiscard]] bool isOccupied(NodeId node) const;
+
+    /**
+     * Liefert die geforderte Stellung einer Weiche oder std::nullopt
+     */
+    [[nodiscard]] std::optional<moba::SwitchStand> getDemandedStand(NodeId node) const;
+
+protected:
+    mutable std::mutex mutex;
+
+    std::vector<std::uint64_t> nodes;
+    std::vector<std::uint64_t> stands;
+
+    // je NodeId: Anzahl der eingestellten Fahrstraßen, die die Weiche fordern
+    std::vector<std::uint32_t> standUsers;
+
+    [[nodiscard]] bool isCompatible(const Route &route) const;
+
+    static bool isSubset(const std::vector<BitWord> &words, const std::vector<std::uint64_t> &bits);
+
+    static void setBits(const std::vector<BitWord> &words, std::vector<std::uint64_t> &bits);
+
+    static void clearBits(const std::vector<BitWord> &words, std::vector<std::uint64_t> &bits);
+
+    void addStands(const std::vector<BitWord> &words);
+
+    void removeStands(const std::vector<BitWord> &words);
+};
@@ -0,0 +1,267 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#include "layoutfile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct MappedStorage::Mapping {
+    Mapping(void *addr, std::size_t size): addr{addr}, size{size} {
+    }
+
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    ~Mapping() noexcept {
+        ::munmap(addr, size);
+    }
+
+    void *addr;
+    std::size_t size;
+};
+
+namespace {
+
+    /**
+     * Temporäre Datei neben path, die mit commit atomar an die Stelle von path tritt.
+     * Ohne commit wird sie im Destruktor wieder entfernt.
+     */
+    class TempFile {
+    public:
+        explicit TempFile(const std::string &path): path{path} {
+            static std::atomic<unsigned int> counter{0};
+
+            // wie bei std::ofstream 0666 abzüglich umask
+            do {
+                tempPath = path + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(counter++);
+                fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+            } while(fd == -1 && errno == EEXIST);
+
+            if(fd == -1) {
+                throw LayoutFileException{"unable to create file <" + path + ">: " + std::strerror(errno)};
+            }
+
+            // Rechte einer bestehenden Datei übernehmen
+            struct stat st{};
+            if(::stat(path.c_str(), &st) == 0) {
+                ::fchmod(fd, st.st_mode & 07777);
+            }
+        }
+
+        TempFile(const TempFile&) = delete;
+        TempFile& operator=(const TempFile&) = delete;
+
+        ~TempFile() noexcept {
+            if(fd != -1) {
+                ::close(fd);
+                ::unlink(tempPath.c_str());
+            }
+        }
+
+        void write(const void *buffer, std::size_t size) {
+            auto ptr = static_cast<const char*>(buffer);
+            while(size) {
+                const auto written = ::write(fd, ptr, size);
+                if(written == -1 && errno == EINTR) {
+                    continue;
+                }
+                if(written <= 0) {
+                    throw LayoutFileException{"unable to write file <" + path + ">: " + std::strerror(errno)};
+                }
+                ptr += written;
+                size -= static_cast<std::size_t>(written);
+            }
+        }
+
+        void write(const void *buffer, std::size_t size, off_t offset) {
+            auto ptr = static_cast<const char*>(buffer);
+            while(size) {
+                const auto written = ::pwrite(fd, ptr, size, offset);
+                if(written == -1 && errno == EINTR) {
+                    continue;
+                }
+                if(written <= 0) {
+                    throw LayoutFileException{"unable to write file <" + path + ">: " + std::strerror(errno)};
+                }
+                ptr += written;
+                size -= static_cast<std::size_t>(written);
+                offset += written;
+            }
+        }
+
+        void commit() {
+            if(::fsync(fd) == -1 || ::close(std::exchange(fd, -1)) == -1) {
+                ::unlink(tempPath.c_str());
+                throw LayoutFileException{"unable to write file <" + path + ">: " + std::strerror(errno)};
+            }
+            if(::rename(tempPath.c_str(), path.c_str()) == -1) {
+                const auto err = errno;
+                ::unlink(tempPath.c_str());
+                throw LayoutFileException{"unable to replace file <" + path + ">: " + std::strerror(err)};
+            }
+
+            // den Verzeichniseintrag ebenfalls dauerhaft machen
+            const auto pos = path.find_last_of('/');
+            const auto dir = pos == std::string::npos ? std::string{"."} : path.substr(0, pos ? pos : 1);
+            const auto dirFd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if(dirFd != -1) {
+                ::fsync(dirFd);
+                ::close(dirFd);
+            }
+        }
+
+    protected:
+        std::string path;
+        std::string tempPath;
+        int fd = -1;
+    };
+}
+
+std::uint64_t getLayoutChecksum(std::span<const std::uint8_t> data, std::uint64_t hash) {
+    for(auto b: data) {
+        hash ^= b;
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+MappedStorage MappedStorage::open(const std::string &path, bool verify) {
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        throw LayoutFileException{"unable to open file <" + path + ">: " + std::strerror(errno)};
+    }
+
+    struct stat st{};
+    if(::fstat(fd, &st) == -1) {
+        ::close(fd);
+        throw LayoutFileException{"unable to stat file <" + path + ">: " + std::strerror(errno)};
+    }
+
+    const auto size = static_cast<std::size_t>(st.st_size);
+    if(size < sizeof(LayoutFileHeader)) {
+        ::close(fd);
+        throw LayoutFileException{"file <" + path + "> is too small"};
+    }
+
+    auto addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(addr == MAP_FAILED) {
+        throw LayoutFileException{"unable to map file <" + path + ">: " + std::strerror(errno)};
+    }
+
+    MappedStorage storage;
+    storage.mapping = std::make_shared<const Mapping>(addr, size);
+    storage.header = static_cast<const LayoutFileHeader*>(addr);
+    storage.data = static_cast<const std::uint8_t*>(addr) + sizeof(LayoutFileHeader);
+
+    const auto &header = *storage.header;
+    if(header.magic != LayoutFileHeader::MAGIC) {
+        throw LayoutFileException{"file <" + path + "> is not a layout file"};
+    }
+    if(header.version != LayoutFileHeader::VERSION || header.headerSize != sizeof(LayoutFileHeader)) {
+        throw LayoutFileException{"file <" + path + "> has unsupported version " + std::to_string(header.version)};
+    }
+    if(header.height && header.width > (size - sizeof(LayoutFileHeader)) / header.height) {
+        throw LayoutFileException{"file <" + path + "> is truncated"};
+    }
+
+    const auto count = header.width * header.height;
+    if(size - sizeof(LayoutFileHeader) != count) {
+        throw LayoutFileException{"file <" + path + "> is truncated"};
+    }
+
+    if(!verify) {
+        return storage;
+    }
+
+    const std::span<const std::uint8_t> data{storage.data, count};
+    if(getLayoutChecksum(data) != header.checksum) {
+        throw LayoutFileException{"checksum mismatch in file <" + path + ">"};
+    }
+
+    std::size_t items = 0;
+    for(auto b: data) {
+        if(b && !Symbol::getInfo(b).type) {
+            throw LayoutFileException{"invalid symbol in file <" + path + ">"};
+        }
+        items += b != 0;
+    }
+    if(items != header.itemsCount) {
+        throw LayoutFileException{"items count mismatch in file <" + path + ">"};
+    }
+    return storage;
+}
+
+Container<Symbol, MappedStorage> openLayoutFile(const std::string &path, bool verify) {
+    auto storage = MappedStorage::open(path, verify);
+
+    Position maxPosition{0, 0};
+    if(storage.getWidth() && storage.getHeight()) {
+        maxPosition = {storage.getWidth() - 1, storage.getHeight() - 1};
+    }
+    const Bounds bounds{storage.getMinPosition(), maxPosition};
+    return {std::move(storage), bounds};
+}
+
+void writeLayoutFile(
+    const std::string &path, std::size_t width, std::size_t height, const Position &minPos,
+    const std::function<void(std::size_t y, std::span<std::uint8_t> row)> &fillRow
+) {
+    // Leser halten die Datei per MAP_SHARED offen: Geschrieben wird daher in eine temporäre
+    // Datei im selben Verzeichnis, die erst vollständig und synchronisiert per rename an
+    // die Stelle der alten tritt. Bestehende Abbildungen behalten so den alten Inhalt.
+    TempFile file{path};
+
+    LayoutFileHeader header{};
+    header.magic = LayoutFileHeader::MAGIC;
+    header.version = LayoutFileHeader::VERSION;
+    header.headerSize = sizeof(LayoutFileHeader);
+    header.width = width;
+    header.height = height;
+    header.minX = minPos.x;
+    header.minY = minPos.y;
+    header.checksum = getLayoutChecksum({});
+
+    // Der Kopf wird erst nach den Daten mit Prüfsumme und Anzahl vervollständigt
+    file.write(&header, sizeof(header));
+
+    std::vector<std::uint8_t> row(width);
+    for(std::size_t y = 0; y < height; ++y) {
+        std::fill(row.begin(), row.end(), 0);
+        fillRow(y, row);
+        header.checksum = getLayoutChecksum(row, header.checksum);
+        header.itemsCount += width - std::count(row.begin(), row.end(), 0);
+        file.write(row.data(), width);
+    }
+
+    file.write(&header, sizeof(header), 0);
+    file.commit();
+}
@@ -0,0 +1,210 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "container.h"
+#include "position.h"
+#include "symbol.h"
+
+class LayoutFileException: public std::exception {
+
+    std::string what_;
+
+public:
+    explicit LayoutFileException(const std::string &err) noexcept: what_{err} {
+    }
+
+    LayoutFileException() noexcept: what_{"Unknown error"} {
+    }
+
+    virtual ~LayoutFileException() noexcept = default;
+
+    virtual const char *what() const noexcept {
+        return this->what_.c_str();
+    }
+};
+
+/**
+ * Kopf einer binären Gleisplan-Datei. Dahinter folgen width * height Symbol-Bytes
+ * zeilenweise (0 = leere Zelle). Alle Werte werden in Host-Byte-Reihenfolge abgelegt.
+ */
+struct LayoutFileHeader {
+    static constexpr std::array<char, 8> MAGIC = {'M', 'O', 'B', 'A', 'L', 'A', 'Y', 'T'};
+    static constexpr std::uint32_t VERSION = 1;
+
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t headerSize;
+    std::uint64_t width;
+    std::uint64_t height;
+    std::uint64_t minX;       // kleinste belegte Spalte
+    std::uint64_t minY;       // kleinste belegte Zeile
+    std::uint64_t itemsCount;
+    std::uint64_t checksum; // FNV-1a über die Symbol-Bytes
+};
+
+static_assert(sizeof(LayoutFileHeader) == 64);
+
+/**
+ * Berechnet fortlaufend die FNV-1a-Prüfsumme über data
+ */
+std::uint64_t getLayoutChecksum(std::span<const std::uint8_t> data, std::uint64_t hash = 0xcbf29ce484222325);
+
+/**
+ * Nur-Lese-Speicherstrategie, die ihre Zellen direkt aus einer per mmap eingeblendeten
+ * Gleisplan-Datei liefert. Es wird nichts kopiert; mehrere Prozesse teilen sich so die
+ * Seiten im Page-Cache. Kopien der Strategie teilen sich dasselbe Mapping.
+ */
+class MappedStorage {
+public:
+    /**
+     * Blendet die Datei path ein. Bei verify == true werden Prüfsumme und sämtliche
+     * Symbole geprüft, ansonsten nur der Kopf.
+     */
+    static MappedStorage open(const std::string &path, bool verify = true);
+
+    [[nodiscard]] std::size_t getWidth() const {
+        return header->width;
+    }
+
+    [[nodiscard]] std::size_t getHeight() const {
+        return header->height;
+    }
+
+    [[nodiscard]] Position getMinPosition() const {
+        return {header->minX, header->minY};
+    }
+
+    std::optional<Symbol> find(const Position &pos) const {
+        if(pos.x >= header->width || pos.y >= header->height) {
+            return std::nullopt;
+        }
+        return toSymbol(data[pos.y * header->width + pos.x]);
+    }
+
+    [[nodiscard]] std::size_t itemsCount() const {
+        return header->itemsCount;
+    }
+
+    [[nodiscard]] std::optional<Position> getFirstPosition() const {
+        const auto size = header->width * header->height;
+        for(std::size_t i = 0; i < size; ++i) {
+            if(toSymbol(data[i])) {
+                return Position{i % header->width, i / header->width};
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::uint8_t getNeighbours(const Position &pos, std::uint8_t directions, std::array<Symbol, 8> &neighbours) const {
+        std::uint8_t found = 0;
+        for(auto bits = directions; bits; bits &= bits - 1) {
+            const auto dir = static_cast<Direction::Position>(bits & -bits);
+            const auto next = pos.step(dir);
+            if(!next) {
+                continue;
+            }
+            if(auto item = find(*next)) {
+                neighbours[std::countr_zero(bits)] = *item;
+                found |= dir;
+            }
+        }
+        return found;
+    }
+
+    std::optional<Symbol> findNext(Position &pos, const Position &from, const Position &to) const {
+        if(!header->width || to.x < from.x) {
+            return std::nullopt;
+        }
+        const auto lastX = std::min<std::size_t>(to.x, header->width - 1);
+        const auto lastY = std::min<std::size_t>(to.y, header->height - 1);
+
+        for(; pos.y <= lastY; pos = {from.x, pos.y + 1}) {
+            for(; pos.x <= lastX; ++pos.x) {
+                if(auto item = toSymbol(data[pos.y * header->width + pos.x])) {
+                    return item;
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+protected:
+    struct Mapping;
+
+    /**
+     * Ungültige Bytes (nur bei verify == false möglich) werden wie leere Zellen behandelt
+     */
+    static std::optional<Symbol> toSymbol(std::uint8_t symbol) {
+        if(!Symbol::getInfo(symbol).type) {
+            return std::nullopt;
+        }
+        return Symbol{symbol};
+    }
+
+    std::shared_ptr<const Mapping> mapping;
+    const LayoutFileHeader *header = nullptr;
+    const std::uint8_t *data = nullptr;
+};
+
+/**
+ * Öffnet eine Gleisplan-Datei als Container ohne die Zellen zu kopieren
+ */
+Container<Symbol, MappedStorage> openLayoutFile(const std::string &path, bool verify = true);
+
+/**
+ * Schreibt einen Gleisplan der Größe width x height in die Datei path. fillRow wird für
+ * jede Zeile mit einem genullten Puffer aufgerufen, der Speicherbedarf ist so auf eine
+ * Zeile begrenzt. Eine bestehende Datei wird atomar ersetzt (temporäre Datei, fsync,
+ * rename), bereits geöffnete Abbildungen sehen weiterhin den alten Stand.
+ */
+void writeLayoutFile(
+    const std::string &path, std::size_t width, std::size_t height, const Position &minPos,
+    const std::function<void(std::size_t y, std::span<std::uint8_t> row)> &fillRow
+);
+
+/**
+ * Schreibt den Gleisplan layout in die Datei path
+ */
+template<typename Storage>
+void writeLayoutFile(const std::string &path, const Container<Symbol, Storage> &layout) {
+    const auto width = layout.itemsCount() ? layout.getWidth() + 1 : 0;
+    const auto height = layout.itemsCount() ? layout.getHeight() + 1 : 0;
+
+    writeLayoutFile(path, width, height, layout.getMinPosition(), [&layout, width](std::size_t y, std::span<std::uint8_t> row) {
+        for(const auto &[pos, symbol]: layout.getViewport({0, y}, {width - 1, y})) {
+            row[pos.x] = symbol.getType();
+        }
+    });
+}
@@ -0,0 +1,271 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#include "layoutreader.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+LayoutReader::LayoutReader(std::istream &in, std::size_t chunkSize): stream{&in}, buffer(chunkSize ? chunkSize : 1) {
+}
+
+LayoutReader::LayoutReader(int fd, std::size_t chunkSize): fd{fd}, buffer(chunkSize ? chunkSize : 1) {
+}
+
+int LayoutReader::peek() {
+    if(begin < end) {
+        return static_cast<unsigned char>(buffer[begin]);
+    }
+
+    begin = 0;
+    end = 0;
+    if(stream) {
+        stream->read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        end = static_cast<std::size_t>(stream->gcount());
+    } else {
+        ssize_t n;
+        do {
+            n = ::read(fd, buffer.data(), buffer.size());
+        } while(n == -1 && errno == EINTR);
+
+        if(n == -1) {
+            throw LayoutReaderException{std::string{"unable to read: "} + std::strerror(errno)};
+        }
+        end = static_cast<std::size_t>(n);
+    }
+    return end ? static_cast<unsigned char>(buffer[0]) : EOF;
+}
+
+int LayoutReader::get() {
+    auto c = peek();
+    if(c != EOF) {
+        ++begin;
+    }
+    if(c == '\n') {
+        ++line;
+    }
+    return c;
+}
+
+void LayoutReader::skipWhitespace() {
+    while(std::isspace(peek())) {
+        get();
+    }
+}
+
+void LayoutReader::expect(char c) {
+    skipWhitespace();
+    if(get() != c) {
+        fail(std::string{"expected '"} + c + "'");
+    }
+}
+
+std::size_t LayoutReader::readNumber() {
+    skipWhitespace();
+    if(!std::isdigit(peek())) {
+        fail("number expected");
+    }
+
+    std::size_t value = 0;
+    while(std::isdigit(peek())) {
+        value = value * 10 + (get() - '0');
+        if(value > 0xFFFFFFFF) {
+            fail("number out of range");
+        }
+    }
+    return value;
+}
+
+std::string LayoutReader::readKey() {
+    expect('"');
+
+    std::string key;
+    for(int c = get(); c != '"'; c = get()) {
+        if(c == EOF || key.size() > 16) {
+            fail("invalid key");
+        }
+        key += static_cast<char>(c);
+    }
+    return key;
+}
+
+Symbol LayoutReader::toSymbol(std::size_t code) const {
+    if(code > 0xFF || !Symbol::getInfo(static_cast<std::uint8_t>(code)).type) {
+        fail("invalid symbol " + std::to_string(code));
+    }
+    return Symbol{static_cast<std::uint8_t>(code)};
+}
+
+void LayoutReader::fail(const std::string &msg) const {
+    throw LayoutReaderException{"line " + std::to_string(line) + ": " + msg};
+}
+
+bool LayoutReader::next(Position &pos, Symbol &symbol) {
+    if(format == Format::UNKNOWN) {
+        skipWhitespace();
+        if(peek() == '[') {
+            get();
+            format = Format::RECORDS;
+        } else {
+            format = Format::GRID;
+        }
+    }
+
+    switch(format) {
+        case Format::GRID:
+            return nextGridCell(pos, symbol);
+
+        case Format::RECORDS:
+            return nextRecord(pos, symbol);
+
+        default:
+            return false;
+    }
+}
+
+bool LayoutReader::nextGridCell(Position &pos, Symbol &symbol) {
+    // Kommas trennen die Felder einer Zeile (",," -> leere Zelle), ohne Komma trennt Leerraum
+    std::size_t commas = 0;
+    bool separated = gridLineStart;
+
+    while(true) {
+        auto c = peek();
+
+        if(c == EOF) {
+            format = Format::DONE;
+            return false;
+        }
+
+        if(c == '\n') {
+            get();
+            gridPos = {0, gridPos.y + 1};
+            gridLineStart = true;
+            separated = true;
+            commas = 0;
+            continue;
+        }
+
+        if(c == ',' || c == ';') {
+            get();
+            ++commas;
+            separated = true;
+            continue;
+        }
+
+        if(std::isspace(c)) {
+            get();
+            separated = true;
+            continue;
+        }
+
+        if(!std::isdigit(c) || !separated) {
+            fail("unexpected character");
+        }
+
+        if(gridLineStart) {
+            gridPos.x = commas;
+        } else {
+            gridPos.x += commas ? commas : 1;
+        }
+        gridLineStart = false;
+        commas = 0;
+        separated = false;
+
+        auto code = readNumber();
+        if(code) {
+            pos = gridPos;
+            symbol = toSymbol(code);
+            return true;
+        }
+    }
+}
+
+bool LayoutReader::nextRecord(Position &pos, Symbol &symbol) {
+    while(true) {
+        skipWhitespace();
+        auto c = get();
+
+        // Datensätze sind durch genau ein Komma getrennt, nach der Liste folgt nichts mehr
+        if(c == ']' && !recordSeparated) {
+            format = Format::DONE;
+            skipWhitespace();
+            if(peek() != EOF) {
+                fail("unexpected data after end of list");
+            }
+            return false;
+        }
+
+        if(recordRead && !recordSeparated) {
+            if(c != ',') {
+                fail(c == EOF ? "unexpected end of input" : "',' or ']' expected");
+            }
+            recordSeparated = true;
+            continue;
+        }
+
+        std::size_t code = 0;
+        if(c == '[') {
+            pos.x = readNumber();
+            expect(',');
+            pos.y = readNumber();
+            expect(',');
+            code = readNumber();
+            expect(']');
+        } else if(c == '{') {
+            unsigned int fields = 0;
+            do {
+                auto key = readKey();
+                expect(':');
+                auto value = readNumber();
+
+                if(key == "x") {
+                    pos.x = value;
+                    fields |= 1;
+                } else if(key == "y") {
+                    pos.y = value;
+                    fields |= 2;
+                } else if(key == "symbol") {
+                    code = value;
+                    fields |= 4;
+                } else {
+                    fail("unknown key \"" + key + "\"");
+                }
+                skipWhitespace();
+            } while(peek() == ',' && get());
+            expect('}');
+
+            if(fields != 7) {
+                fail("incomplete record");
+            }
+        } else {
+            fail(c == EOF ? "unexpected end of input" : "record expected");
+        }
+        recordRead = true;
+        recordSeparated = false;
+
+        if(code) {
+            symbol = toSymbol(code);
+            return true;
+        }
+    }
+}
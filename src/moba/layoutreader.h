@@ -0,0 +1,138 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "container.h"
+#include "position.h"
+#include "symbol.h"
+
+class LayoutReaderException: public std::exception {
+
+    std::string what_;
+
+public:
+    explicit LayoutReaderException(const std::string &err) noexcept: what_{err} {
+    }
+
+    LayoutReaderException() noexcept: what_{"Unknown error"} {
+    }
+
+    virtual ~LayoutReaderException() noexcept = default;
+
+    virtual const char *what() const noexcept {
+        return this->what_.c_str();
+    }
+};
+
+/**
+ * Liest eine Gleisplan-Beschreibung stückweise aus einem std::istream oder einem
+ * Datei-Deskriptor. Der Speicherbedarf ist unabhängig von der Größe des Gleisplans auf
+ * chunkSize begrenzt. Das Format wird am ersten Zeichen erkannt:
+ *
+ * - Raster: eine Zeile pro Gleisplan-Zeile, Symbol-Codes durch Komma oder Leerzeichen
+ *   getrennt, leere Felder (",,") und 0 stehen für leere Zellen
+ * - Liste: "[[x, y, symbol], ...]" bzw. "[{"x": 1, "y": 2, "symbol": 17}, ...]"
+ */
+class LayoutReader {
+public:
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    explicit LayoutReader(std::istream &in, std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+    explicit LayoutReader(int fd, std::size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+    /**
+     * Liest die nächste belegte Zelle. Ungültige Symbole oder Syntaxfehler führen zu
+     * einer LayoutReaderException mit Zeilenangabe.
+     *
+     * @return bool false -> Ende der Eingabe erreicht
+     */
+    bool next(Position &pos, Symbol &symbol);
+
+    /**
+     * Zeile der zuletzt gelesenen Zelle (für Fehlermeldungen)
+     */
+    [[nodiscard]] std::size_t getLine() const {
+        return line;
+    }
+
+protected:
+    enum class Format {
+        UNKNOWN,
+        GRID,
+        RECORDS,
+        DONE
+    };
+
+    int peek();
+    int get();
+    void skipWhitespace();
+    void expect(char c);
+    std::size_t readNumber();
+    std::string readKey();
+
+    bool nextGridCell(Position &pos, Symbol &symbol);
+    bool nextRecord(Position &pos, Symbol &symbol);
+
+    Symbol toSymbol(std::size_t code) const;
+
+    [[noreturn]] void fail(const std::string &msg) const;
+
+    std::istream *stream = nullptr;
+    int fd = -1;
+
+    std::vector<char> buffer;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+
+    Format format = Format::UNKNOWN;
+    std::size_t line = 1;
+
+    Position gridPos; // Spalte des zuletzt gelesenen Feldes
+    bool gridLineStart = true;
+
+    bool recordRead = false;      // mindestens ein Datensatz gelesen
+    bool recordSeparated = false; // Komma nach dem letzten Datensatz gelesen
+};
+
+/**
+ * Liest sämtliche Zellen aus reader in den Container layout. Positionen, die der
+ * Speicher nicht abbilden kann, führen ebenfalls zu einer LayoutReaderException.
+ */
+template<typename Storage>
+void readLayout(LayoutReader &reader, Container<Symbol, Storage> &layout) {
+    Position pos;
+    Symbol symbol;
+    while(reader.next(pos, symbol)) {
+        try {
+            layout.addItem(pos, symbol);
+        } catch(const std::out_of_range &e) {
+            throw LayoutReaderException{"line " + std::to_string(reader.getLine()) + ": " + e.what()};
+        }
+    }
+}
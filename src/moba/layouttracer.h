@@ -0,0 +1,684 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "container.h"
+#include "node_block.h"
+#include "node_crossoverswitch.h"
+#include "node_simpleswitch.h"
+#include "node_threewayswitch.h"
+#include "nodegraph.h"
+#include "packedposition.h"
+#include "symbol.h"
+
+class LayoutTracerException: public std::exception {
+
+    std::string what_;
+
+public:
+    explicit LayoutTracerException(const std::string &err) noexcept: what_{err} {
+    }
+
+    LayoutTracerException() noexcept: what_{"Unknown error"} {
+    }
+
+    virtual ~LayoutTracerException() noexcept = default;
+
+    virtual const char *what() const noexcept {
+        return this->what_.c_str();
+    }
+};
+
+/**
+ * Verbindungspunkt dir der Zelle pos, an dem das Gleis ins Leere läuft (leere
+ * Zelle, Rand oder Nachbar ohne passenden Gegenanschluss)
+ */
+struct UnconnectedJunction {
+    Position pos;
+    Direction dir;
+
+    friend bool operator<(const UnconnectedJunction &lhs, const UnconnectedJunction &rhs) {
+        if(lhs.pos != rhs.pos) {
+            return lhs.pos < rhs.pos;
+        }
+        return static_cast<int>(lhs.dir) < static_cast<int>(rhs.dir);
+    }
+};
+
+/**
+ * Ergebnis von LayoutTracer::trace: alle Knoten nach Position sowie alle offenen
+ * Verbindungspunkte, jeweils zeilenweise sortiert
+ */
+struct LayoutGraph {
+    std::map<Position, NodePtr> nodes;
+    std::set<UnconnectedJunction> unconnected;
+};
+
+/**
+ * Erzeugt aus einem Gleisplan den verketteten Knotengraphen. Knoten sind alle Weichen
+ * sowie die vom Aufrufer vorgegebenen Blöcke (nur auf geraden Gleisen oder Prellböcken).
+ * Weichen erhalten in Zeilenreihenfolge fortlaufende Ids im Anschluss an die höchste
+ * Block-Id.
+ *
+ * Die Verfolgung arbeitet eine explizite Arbeitsliste ab statt zu rekursieren. Jeder
+ * Verbindungspunkt eines Knotens wird über die dynamischen Anschlüsse des Symbols
+ * genau einmal abgehakt, jedes Gleisstück zwischen zwei Knoten genau einmal durchlaufen.
+ * Der Aufwand ist damit linear in der Anzahl der Zellen.
+ *
+ * traceParallel verfolgt unabhängige Teile des Gleisplans (Zusammenhangskomponenten)
+ * gleichzeitig und liefert dasselbe Ergebnis wie trace.
+ *
+ * Jeder verfolgte Gleisabschnitt (Segment) wird samt seiner Zellen gemerkt. Nach einer
+ * Änderung am Gleisplan verfolgt update nur die Segmente durch die geänderten Zellen neu.
+ */
+template<typename Storage = MapStorage<Symbol>>
+class LayoutTracer {
+public:
+    using BlockMap = std::map<Position, unsigned int>;
+
+    LayoutTracer(const Container<Symbol, Storage> &layout, BlockMap blocks):
+    layout{layout}, blocks{std::move(blocks)} {
+    }
+
+    LayoutTracer(const LayoutTracer&) = delete;
+    LayoutTracer(LayoutTracer&&) = default;
+
+    LayoutTracer &operator=(const LayoutTracer&) = delete;
+
+    /**
+     * Blöcke und Weichen verweisen gegenseitig per NodePtr aufeinander. Die Verknüpfungen
+     * werden daher beim Neuaufbau und hier aufgelöst, sonst würden die Knoten nie
+     * freigegeben. Knoten, die der Aufrufer darüber hinaus hält, verlieren ihre Nachbarn.
+     */
+    ~LayoutTracer() noexcept {
+        unlinkNodes();
+    }
+
+    /**
+     * Baut den Graphen komplett neu auf. Die Referenz bleibt bis zum nächsten Aufruf
+     * von trace, traceParallel oder update gültig.
+     */
+    const LayoutGraph &trace() {
+        std::vector<std::uint64_t> worklist;
+        std::vector<Segment> traced;
+
+        createNodes(worklist);
+
+        for(const auto key: worklist) {
+            traceNode(key, traced);
+        }
+        return finish(traced, worklist);
+    }
+
+    /**
+     * Wie trace, verteilt die Zusammenhangskomponenten aber auf threads Threads. Knoten
+     * und Ids werden vorab sequenziell angelegt, jede Komponente wird von genau einem
+     * Thread verfolgt. Da sich Komponenten keine Knoten teilen, ist keine Synchronisation
+     * nötig und das Ergebnis ist identisch zu trace.
+     */
+    const LayoutGraph &traceParallel(unsigned int threads = std::thread::hardware_concurrency()) {
+        if(threads < 2) {
+            return trace();
+        }
+
+        std::vector<std::uint64_t> worklist;
+        ComponentLabeler labeler{layout.itemsCount()};
+
+        createNodes(worklist, &labeler);
+
+        auto components = getComponents(worklist, labeler);
+
+        std::vector<std::vector<Segment>> traced(components.size());
+        std::vector<std::exception_ptr> errors(components.size());
+        std::atomic<std::size_t> next{0};
+
+        auto worker = [&] {
+            std::size_t i;
+            while((i = next.fetch_add(1, std::memory_order_relaxed)) < components.size()) {
+                try {
+                    for(const auto key: components[i]) {
+                        traceNode(key, traced[i]);
+                    }
+                } catch(...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+
+        const auto count = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(components.size(), 1));
+        {
+            std::vector<std::jthread> pool;
+            pool.reserve(count - 1);
+            for(std::size_t i = 1; i < count; ++i) {
+                pool.emplace_back(worker);
+            }
+            worker();
+        }
+
+        for(const auto &error: errors) {
+            if(error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        for(auto &part: traced) {
+            for(auto &segment: part) {
+                addSegment(std::move(segment));
+            }
+        }
+        return finish({}, worklist);
+    }
+
+    /**
+     * Überträgt den aktuellen Graphen samt Weichenstellungen in eine NodeGraph-Arena.
+     * NodeIds werden in Zeilenreihenfolge vergeben.
+     */
+    NodeGraph getNodeGraph() const {
+        NodeGraph arena;
+        arena.reserve(graph.nodes.size());
+
+        std::unordered_map<std::uint64_t, NodeId> nodeIds;
+        nodeIds.reserve(graph.nodes.size());
+
+        for(const auto &[pos, node]: graph.nodes) {
+            const auto key = getKey(pos);
+            nodeIds.emplace(key, arena.addNode(getNodeKind(cells.at(key)), node->getId(), node->getState()));
+        }
+
+        for(const auto &[id, segment]: segments) {
+            if(!segment.toNode) {
+                continue;
+            }
+            const auto &from = cells.at(segment.from);
+            const auto &to = cells.at(segment.to);
+            arena.connect(
+                nodeIds.at(segment.from), getNodeDirection(from, segment.fromDir),
+                nodeIds.at(segment.to), getNodeDirection(to, segment.toDir)
+            );
+        }
+        return arena;
+    }
+
+    /**
+     * Gleicht den Graphen an einen geänderten Gleisplan an. changed enthält alle Zellen,
+     * die seit dem letzten Aufruf hinzugefügt, entfernt oder ersetzt wurden. Neu verfolgt
+     * werden nur die Segmente durch diese Zellen bzw. an offenen Stellen davor sowie die
+     * Anschlüsse geänderter Knoten. Alle übrigen Knoten bleiben samt Id und Stellung
+     * erhalten, eine geänderte Weiche gleicher Bauart ebenso. Der Aufwand hängt damit
+     * nur von der Größe der Änderung ab.
+     */
+    const LayoutGraph &update(const std::vector<Position> &changed) {
+        for(const auto &pos: changed) {
+            if(blocks.contains(pos)) {
+                checkBlock(pos);
+            }
+        }
+
+        std::set<Position> pending;
+
+        for(const auto &pos: changed) {
+            const auto key = getKey(pos);
+            for(auto iter = segmentIndex.find(key); iter != segmentIndex.end(); iter = segmentIndex.find(key)) {
+                removeSegment(iter->second, pending);
+            }
+            if(auto iter = cells.find(key); iter != cells.end()) {
+                for(const auto id: iter->second.ports) {
+                    if(id != npos) {
+                        removeSegment(id, pending);
+                    }
+                }
+            }
+        }
+
+        for(const auto &pos: changed) {
+            updateNode(pos, pending);
+        }
+
+        std::vector<Segment> traced;
+        for(const auto &pos: pending) {
+            if(cells.contains(getKey(pos))) {
+                traceNode(getKey(pos), traced);
+            }
+        }
+        for(auto &segment: traced) {
+            addSegment(std::move(segment));
+        }
+        return graph;
+    }
+
+protected:
+    static constexpr auto npos = static_cast<std::size_t>(-1);
+
+    struct NodeCell {
+        Position    pos;
+        Symbol      symbol; // dynamische Anschlüsse: noch nicht verfolgte Verbindungspunkte
+        NodePtr     node;
+        bool        isBlock;
+        std::size_t component = 0;
+
+        std::array<std::size_t, 8> ports = makePorts(); // Segment je Anschluss (Bitnummer der Richtung)
+    };
+
+    /**
+     * Verfolgter Gleisabschnitt ab dem Anschluss fromDir des Knotens from. Er endet an
+     * einem Knoten (to / toDir), an einem Prellbock oder an einer offenen Stelle (open).
+     * cells enthält alle durchlaufenen Zellen sowie ggf. die Zelle hinter der offenen
+     * Stelle, also alle Zellen, deren Änderung den Abschnitt betrifft.
+     */
+    struct Segment {
+        std::uint64_t from;
+        Direction     fromDir;
+        bool          toNode = false;
+        std::uint64_t to = 0;
+        Direction     toDir{};
+
+        std::optional<UnconnectedJunction> open{};
+        std::vector<std::uint64_t> cells{};
+    };
+
+    /**
+     * Ermittelt die Zusammenhangskomponenten in einem zeilenweisen Durchlauf: Jede Zelle
+     * wird per Union-Find mit den bereits besuchten Nachbarn (links sowie die drei Zellen
+     * der vorherigen Zeile) verbunden, sofern beide den passenden Anschluss haben. Es
+     * werden nur die aktuelle und die vorherige Zeile vorgehalten.
+     */
+    class ComponentLabeler {
+    public:
+        explicit ComponentLabeler(std::size_t count) {
+            parent.reserve(count);
+        }
+
+        std::size_t add(const Position &pos, std::uint8_t type) {
+            if(pos.y != rowY) {
+                prevRow.clear();
+                if(pos.y == rowY + 1) {
+                    std::swap(prevRow, curRow);
+                }
+                curRow.clear();
+                rowY = pos.y;
+                prevIdx = 0;
+            }
+
+            const auto label = parent.size();
+            parent.push_back(label);
+
+            if(!curRow.empty() && curRow.back().x + 1 == pos.x) {
+                connect(label, type, curRow.back(), Direction::LEFT);
+            }
+
+            while(prevIdx < prevRow.size() && prevRow[prevIdx].x + 1 < pos.x) {
+                ++prevIdx;
+            }
+            for(auto i = prevIdx; i < prevRow.size() && prevRow[i].x <= pos.x + 1; ++i) {
+                const auto &cell = prevRow[i];
+                if(cell.x + 1 == pos.x) {
+                    connect(label, type, cell, Direction::TOP_LEFT);
+                } else if(cell.x == pos.x) {
+                    connect(label, type, cell, Direction::TOP);
+                } else {
+                    connect(label, type, cell, Direction::TOP_RIGHT);
+                }
+            }
+            curRow.push_back({pos.x, label, type});
+            return label;
+        }
+
+        std::size_t find(std::size_t label) {
+            while(parent[label] != label) {
+                label = parent[label] = parent[parent[label]];
+            }
+            return label;
+        }
+
+    protected:
+        struct Cell {
+            std::size_t  x;
+            std::size_t  label;
+            std::uint8_t type;
+        };
+
+        std::vector<std::size_t> parent;
+        std::vector<Cell> prevRow;
+        std::vector<Cell> curRow;
+        std::size_t prevIdx = 0;
+        std::size_t rowY = static_cast<std::size_t>(-1);
+
+        void connect(std::size_t label, std::uint8_t type, const Cell &cell, Direction dir) {
+            if(!(type & dir) || !(cell.type & dir.getComplementaryDirection())) {
+                return;
+            }
+            auto a = find(label);
+            auto b = find(cell.label);
+            if(a != b) {
+                parent[std::max(a, b)] = std::min(a, b);
+            }
+        }
+    };
+
+    const Container<Symbol, Storage> &layout;
+    BlockMap blocks;
+
+    LayoutGraph graph;
+    unsigned int nextId = 0;
+
+    std::unordered_map<std::uint64_t, NodeCell> cells;
+    std::unordered_map<std::size_t, Segment> segments;
+    std::unordered_multimap<std::uint64_t, std::size_t> segmentIndex;
+    std::size_t nextSegment = 0;
+
+    static std::uint64_t getKey(const Position &pos) {
+        return PackedPosition{pos}.getKey();
+    }
+
+    static constexpr std::array<std::size_t, 8> makePorts() {
+        std::array<std::size_t, 8> ports;
+        ports.fill(npos);
+        return ports;
+    }
+
+    static std::size_t getPortIndex(Direction dir) {
+        return std::countr_zero(static_cast<std::uint8_t>(dir));
+    }
+
+    Symbol checkBlock(const Position &pos) const {
+        auto symbol = layout.tryGet(pos);
+        if(!symbol) {
+            throw LayoutTracerException{"block position is empty"};
+        }
+        if(!symbol->isStraight() && !symbol->isEnd()) {
+            throw LayoutTracerException{"block must be placed on a straight track"};
+        }
+        return *symbol;
+    }
+
+    void createNodes(std::vector<std::uint64_t> &worklist, ComponentLabeler *labeler = nullptr) {
+        unlinkNodes();
+        graph = {};
+        cells.clear();
+        cells.reserve(blocks.size());
+        segments.clear();
+        segmentIndex.clear();
+
+        nextId = 0;
+        for(const auto &[pos, id]: blocks) {
+            cells.emplace(getKey(pos), NodeCell{pos, checkBlock(pos), std::make_shared<Block>(id), true});
+            nextId = std::max(nextId, id + 1);
+        }
+
+        for(const auto &[pos, symbol]: layout.getViewport()) {
+            const auto component = labeler ? labeler->add(pos, symbol.getType()) : 0;
+            const auto key = getKey(pos);
+
+            if(auto iter = cells.find(key); iter != cells.end()) {
+                iter->second.component = component;
+                worklist.push_back(key);
+                continue;
+            }
+            auto node = createSwitch(symbol, nextId);
+            if(!node) {
+                continue;
+            }
+            ++nextId;
+            cells.emplace(key, NodeCell{pos, symbol, std::move(node), false, component});
+            worklist.push_back(key);
+        }
+    }
+
+    static void unlinkNode(Node &node) {
+        for(std::uint8_t bit = 1; bit; bit <<= 1) {
+            const Direction dir{bit};
+            if(auto next = node.findJunctionNode(dir); next && *next) {
+                node.setJunctionNode(dir, NodePtr{});
+            }
+        }
+    }
+
+    void unlinkNodes() noexcept {
+        for(auto &[key, cell]: cells) {
+            unlinkNode(*cell.node);
+        }
+    }
+
+    /**
+     * Verteilt die Knoten auf ihre Komponenten. Komponenten und Knoten darin bleiben in
+     * Zeilenreihenfolge, damit die Aufteilung unabhängig von der Thread-Anzahl ist.
+     */
+    std::vector<std::vector<std::uint64_t>> getComponents(
+        const std::vector<std::uint64_t> &worklist, ComponentLabeler &labeler
+    ) {
+        std::vector<std::vector<std::uint64_t>> components;
+        std::unordered_map<std::size_t, std::size_t> index;
+
+        for(const auto key: worklist) {
+            const auto root = labeler.find(cells.at(key).component);
+            auto [iter, inserted] = index.try_emplace(root, components.size());
+            if(inserted) {
+                components.emplace_back();
+            }
+            components[iter->second].push_back(key);
+        }
+        return components;
+    }
+
+    const LayoutGraph &finish(std::vector<Segment> traced, const std::vector<std::uint64_t> &worklist) {
+        for(auto &segment: traced) {
+            addSegment(std::move(segment));
+        }
+        for(const auto key: worklist) {
+            auto &cell = cells.at(key);
+            graph.nodes.emplace_hint(graph.nodes.end(), cell.pos, cell.node);
+        }
+        return graph;
+    }
+
+    void addSegment(Segment segment) {
+        const auto id = nextSegment++;
+
+        cells.at(segment.from).ports[getPortIndex(segment.fromDir)] = id;
+        if(segment.toNode) {
+            cells.at(segment.to).ports[getPortIndex(segment.toDir)] = id;
+        }
+        if(segment.open) {
+            graph.unconnected.insert(*segment.open);
+        }
+        for(const auto key: segment.cells) {
+            segmentIndex.emplace(key, id);
+        }
+        segments.emplace(id, std::move(segment));
+    }
+
+    /**
+     * Entfernt ein Segment samt der Verknüpfungen an beiden Enden. Die betroffenen
+     * Anschlüsse werden wieder geöffnet und ihre Knoten in pending vorgemerkt.
+     */
+    void removeSegment(std::size_t id, std::set<Position> &pending) {
+        auto iter = segments.find(id);
+        if(iter == segments.end()) {
+            return;
+        }
+        auto &segment = iter->second;
+
+        releasePort(segment.from, segment.fromDir, pending);
+        if(segment.toNode) {
+            releasePort(segment.to, segment.toDir, pending);
+        }
+        if(segment.open) {
+            graph.unconnected.erase(*segment.open);
+        }
+        for(const auto key: segment.cells) {
+            for(auto [cur, end] = segmentIndex.equal_range(key); cur != end;) {
+                cur = cur->second == id ? segmentIndex.erase(cur) : std::next(cur);
+            }
+        }
+        segments.erase(iter);
+    }
+
+    void releasePort(std::uint64_t key, Direction dir, std::set<Position> &pending) {
+        auto &cell = cells.at(key);
+        cell.node->setJunctionNode(getNodeDirection(cell, dir), NodePtr{});
+        cell.ports[getPortIndex(dir)] = npos;
+        cell.symbol.addJunction(dir);
+        pending.insert(cell.pos);
+    }
+
+    /**
+     * Legt nach einer Änderung an pos den Knoten neu an, behält ihn (Block oder Weiche
+     * gleicher Bauart) oder entfernt ihn. Alle Segmente an pos sind bereits entfernt.
+     */
+    void updateNode(const Position &pos, std::set<Position> &pending) {
+        const auto key = getKey(pos);
+        const auto symbol = layout.tryGet(pos);
+        auto iter = cells.find(key);
+
+        if(iter != cells.end()) {
+            auto &cell = iter->second;
+            if(cell.isBlock || (symbol && symbol->getBaseType() == cell.symbol.getBaseType())) {
+                cell.symbol = *symbol;
+                pending.insert(pos);
+                return;
+            }
+            unlinkNode(*cell.node);
+            cells.erase(iter);
+            graph.nodes.erase(pos);
+        }
+
+        if(!symbol) {
+            return;
+        }
+        auto node = createSwitch(*symbol, nextId);
+        if(!node) {
+            return;
+        }
+        ++nextId;
+        graph.nodes.emplace(pos, node);
+        cells.emplace(key, NodeCell{pos, *symbol, std::move(node), false});
+        pending.insert(pos);
+    }
+
+    static NodeKind getNodeKind(const NodeCell &cell) {
+        if(cell.isBlock) {
+            return NodeKind::BLOCK;
+        }
+        if(cell.symbol.isThreeWaySwitch()) {
+            return NodeKind::THREE_WAY_SWITCH;
+        }
+        if(cell.symbol.isCrossOverSwitch()) {
+            return NodeKind::CROSS_OVER_SWITCH;
+        }
+        return NodeKind::SIMPLE_SWITCH;
+    }
+
+    static NodePtr createSwitch(const Symbol &symbol, unsigned int id) {
+        if(symbol.isSimpleSwitch()) {
+            return std::make_shared<SimpleSwitch>(id);
+        }
+        if(symbol.isThreeWaySwitch()) {
+            return std::make_shared<ThreeWaySwitch>(id);
+        }
+        if(symbol.isCrossOverSwitch()) {
+            return std::make_shared<CrossOverSwitch>(id);
+        }
+        return NodePtr{};
+    }
+
+    /**
+     * Weichen werden über die Richtungen ihres kanonischen Musters angeschlossen,
+     * Blöcke über die tatsächliche Richtung
+     */
+    static Direction getNodeDirection(const NodeCell &cell, Direction dir) {
+        if(cell.isBlock) {
+            return dir;
+        }
+        return dir - Symbol::getInfo(cell.symbol.getType()).distance;
+    }
+
+    void traceNode(std::uint64_t key, std::vector<Segment> &traced) {
+        auto &cell = cells.at(key);
+
+        while(cell.symbol.hasOpenJunctionsLeft()) {
+            const auto dir = cell.symbol.getNextOpenJunction();
+            cell.symbol.removeJunction(dir);
+            traced.push_back(traceJunction(key, cell, dir));
+        }
+    }
+
+    /**
+     * Folgt dem Gleis ab dem Verbindungspunkt dir des Knotens start bis zum nächsten
+     * Knoten, einem Prellbock oder einer offenen Stelle
+     */
+    Segment traceJunction(std::uint64_t startKey, NodeCell &start, const Direction startDir) {
+        Segment segment{.from = startKey, .fromDir = startDir};
+
+        auto pos = start.pos;
+        auto dir = startDir;
+
+        while(true) {
+            const auto next = pos.step(dir);
+            const auto from = dir.getComplementaryDirection();
+            const auto symbol = next ? layout.tryGet(*next) : std::nullopt;
+
+            if(!symbol || !(symbol->getType() & from)) {
+                if(next && PackedPosition::fits(*next)) {
+                    segment.cells.push_back(getKey(*next));
+                }
+                segment.open = UnconnectedJunction{pos, dir};
+                return segment;
+            }
+
+            const auto key = getKey(*next);
+            if(auto iter = cells.find(key); iter != cells.end()) {
+                auto &end = iter->second;
+                end.symbol.removeJunction(from);
+                start.node->setJunctionNode(getNodeDirection(start, startDir), end.node);
+                end.node->setJunctionNode(getNodeDirection(end, from), start.node);
+                segment.toNode = true;
+                segment.to = key;
+                segment.toDir = from;
+                return segment;
+            }
+
+            segment.cells.push_back(key);
+            if(symbol->isEnd()) {
+                return segment;
+            }
+
+            pos = *next;
+            if(symbol->isBend()) {
+                dir = Direction{static_cast<std::uint8_t>(symbol->getType() & ~static_cast<std::uint8_t>(from))};
+            }
+        }
+    }
+};
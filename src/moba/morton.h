@@ -0,0 +1,153 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "direction.h"
+
+/**
+ * Morton-Code (Z-Ordnung) einer Position: die Bits von x liegen auf den geraden, die
+ * von y auf den ungeraden Bitpositionen. In 2D benachbarte Zellen liegen so auch in
+ * der Sortierung meist nahe beieinander.
+ */
+struct Morton {
+    static constexpr std::uint64_t X_MASK = 0x5555555555555555;
+    static constexpr std::uint64_t Y_MASK = 0xAAAAAAAAAAAAAAAA;
+
+    static constexpr std::uint64_t encode(std::uint32_t x, std::uint32_t y) {
+        return spread(x) | spread(y) << 1;
+    }
+
+    static constexpr std::uint32_t decodeX(std::uint64_t code) {
+        return compact(code);
+    }
+
+    static constexpr std::uint32_t decodeY(std::uint64_t code) {
+        return compact(code >> 1);
+    }
+
+    static constexpr std::uint64_t incX(std::uint64_t code) {
+        return (((code | Y_MASK) + 1) & X_MASK) | (code & Y_MASK);
+    }
+
+    static constexpr std::uint64_t decX(std::uint64_t code) {
+        return (((code & X_MASK) - 1) & X_MASK) | (code & Y_MASK);
+    }
+
+    static constexpr std::uint64_t incY(std::uint64_t code) {
+        return (((code | X_MASK) + 1) & Y_MASK) | (code & X_MASK);
+    }
+
+    static constexpr std::uint64_t decY(std::uint64_t code) {
+        return (((code & Y_MASK) - 1) & Y_MASK) | (code & X_MASK);
+    }
+
+    /**
+     * Liefert den Code der Nachbarzelle in Richtung dir, ohne zu dekodieren. Wie bei
+     * Position::setNewPosition laufen die Koordinaten am Rand über.
+     */
+    static constexpr std::uint64_t step(std::uint64_t code, Direction dir) {
+        switch(dir) {
+            case Direction::TOP:
+                return decY(code);
+
+            case Direction::TOP_RIGHT:
+                return incX(decY(code));
+
+            case Direction::RIGHT:
+                return incX(code);
+
+            case Direction::BOTTOM_RIGHT:
+                return incX(incY(code));
+
+            case Direction::BOTTOM:
+                return incY(code);
+
+            case Direction::BOTTOM_LEFT:
+                return decX(incY(code));
+
+            case Direction::LEFT:
+                return decX(code);
+
+            case Direction::TOP_LEFT:
+                return decX(decY(code));
+
+            default:
+                return code;
+        }
+    }
+
+    /**
+     * BIGMIN nach Tropf / Herzog: kleinster Code innerhalb des Rechtecks min / max, der
+     * größer als code ist. code muss zwischen min und max, aber außerhalb des Rechtecks liegen.
+     */
+    static constexpr std::uint64_t getNextInRange(std::uint64_t code, std::uint64_t min, std::uint64_t max) {
+        std::uint64_t next = 0;
+
+        for(int bit = 63; bit >= 0; --bit) {
+            const auto mask = std::uint64_t{1} << bit;
+            const auto below = (bit & 1 ? Y_MASK : X_MASK) & (mask - 1);
+
+            const bool c = code & mask;
+            const bool lo = min & mask;
+            const bool hi = max & mask;
+
+            if(!c && !lo && hi) {
+                next = (min | mask) & ~below;
+                max = (max & ~mask) | below;
+            } else if(!c && lo && hi) {
+                return min;
+            } else if(c && !lo && !hi) {
+                return next;
+            } else if(c && !lo && hi) {
+                min = (min | mask) & ~below;
+            }
+        }
+        return next;
+    }
+
+protected:
+    static constexpr std::uint64_t spread(std::uint64_t v) {
+        v = (v | v << 16) & 0x0000FFFF0000FFFF;
+        v = (v | v << 8) & 0x00FF00FF00FF00FF;
+        v = (v | v << 4) & 0x0F0F0F0F0F0F0F0F;
+        v = (v | v << 2) & 0x3333333333333333;
+        v = (v | v << 1) & 0x5555555555555555;
+        return v;
+    }
+
+    static constexpr std::uint32_t compact(std::uint64_t v) {
+        v &= 0x5555555555555555;
+        v = (v | v >> 1) & 0x3333333333333333;
+        v = (v | v >> 2) & 0x0F0F0F0F0F0F0F0F;
+        v = (v | v >> 4) & 0x00FF00FF00FF00FF;
+        v = (v | v >> 8) & 0x0000FFFF0000FFFF;
+        v = (v | v >> 16) & 0x00000000FFFFFFFF;
+        return static_cast<std::uint32_t>(v);
+    }
+};
+
+static_assert(Morton::encode(3, 5) == 0b100111);
+static_assert(Morton::decodeX(Morton::encode(123456, 654321)) == 123456);
+static_assert(Morton::decodeY(Morton::encode(123456, 654321)) == 654321);
+static_assert(Morton::step(Morton::encode(7, 8), Direction::TOP_LEFT) == Morton::encode(6, 7));
+static_assert(Morton::step(Morton::encode(7, 8), Direction::BOTTOM_RIGHT) == Morton::encode(8, 9));
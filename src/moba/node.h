@@ -20,27 +20,85 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <optional>
 #include <moba-common/enumswitchstand.h>
 
 #include "direction.h"
 #include "nodeexception.h"
+#include "nodekinds.h"
 
 struct Node;
 using NodePtr = std::shared_ptr<Node>;
 
+/**
+ * Die Weichenstellung ist atomar: turn und compareAndTurn dürfen ohne weitere Sperre
+ * gleichzeitig zu Fahrwegabfragen (findJunctionNode, getJunctionNode) aufgerufen werden.
+ * Gespeichert wird mit release, gelesen mit acquire; wer eine neue Stellung sieht, sieht
+ * also auch alles, was der stellende Thread vor turn geschrieben hat. Eine Abfrage liest
+ * die Stellung genau einmal und arbeitet durchgehend mit diesem Wert.
+ *
+ * Die Verknüpfungen (setJunctionNode) sind davon ausgenommen und dürfen nicht parallel
+ * zu Abfragen geändert werden.
+ */
 struct Node {
     Node(unsigned int id, moba::SwitchStand switchStand = moba::SwitchStand::STRAIGHT_1): 
     id{id}, currentState{switchStand} {
     }
 
     virtual ~Node() noexcept = default;
-    virtual NodePtr getJunctionNode(NodePtr node) const = 0;
-    virtual NodePtr getJunctionNode(Direction dir) const = 0;
+
+    /**
+     * Liefert den Knoten, zu dem man gelangt, wenn man über node in diesen Knoten einfährt.
+     * Ein leerer NodePtr bedeutet, dass die Weiche in diese Richtung nicht gestellt ist.
+     * std::nullopt, wenn node kein Nachbar dieses Knotens ist.
+     */
+    virtual std::optional<NodePtr> findJunctionNode(const NodePtr &node) const = 0;
+
+    /**
+     * Liefert den in Richtung dir angeschlossenen Knoten oder std::nullopt, wenn der
+     * Knoten in dieser Richtung keinen Anschluss hat
+     */
+    virtual std::optional<NodePtr> findJunctionNode(Direction dir) const = 0;
+
     virtual void setJunctionNode(Direction dir, NodePtr node) = 0;
 
-    void turn(moba::SwitchStand stand) {
-        currentState = stand;
+    NodePtr getJunctionNode(const NodePtr &node) const {
+        auto next = findJunctionNode(node);
+        if(!next) {
+            throw NodeException{"invalid node given!"};
+        }
+        return *next;
+    }
+
+    NodePtr getJunctionNode(Direction dir) const {
+        auto next = findJunctionNode(dir);
+        if(!next) {
+            throw NodeException{"invalid direction given!"};
+        }
+        return *next;
+    }
+
+    virtual void turn(moba::SwitchStand stand) {
+        currentState.store(stand, std::memory_order_release);
+    }
+
+    /**
+     * Stellt die Weiche nur dann auf desired, wenn sie noch auf expected steht
+     *
+     * @return true, wenn gestellt wurde
+     */
+    virtual bool compareAndTurn(moba::SwitchStand expected, moba::SwitchStand desired) {
+        return currentState.compare_exchange_strong(
+            expected, desired, std::memory_order_acq_rel, std::memory_order_acquire
+        );
+    }
+
+    [[nodiscard]] virtual moba::SwitchStand getState() const {
+        return currentState.load(std::memory_order_acquire);
     }
 
     [[nodiscard]] unsigned int getId() const {
@@ -49,6 +107,39 @@ struct Node {
 
 protected:
     unsigned int id;
-    moba::SwitchStand currentState;
+    std::atomic<moba::SwitchStand> currentState;
+
+    static_assert(std::atomic<moba::SwitchStand>::is_always_lock_free);
+
+    /**
+     * Aktive Zeile der Übergangstabelle (siehe nodekinds.h) zur aktuellen Stellung
+     */
+    [[nodiscard]] std::size_t getActiveRow() const {
+        return getStateRow(currentState.load(std::memory_order_acquire));
+    }
+
+    /**
+     * Fahrweg über die Übergangstabelle: ports bildet die Anschlüsse der Knotenart auf
+     * die Verweise der Klasse ab
+     */
+    template<std::size_t N>
+    static std::optional<NodePtr> findTransitionNode(
+        const std::array<const NodePtr*, N> &ports, const TransitionRow &row, const NodePtr &node
+    ) {
+        bool found = false;
+        for(std::size_t p = 0; p < N; ++p) {
+            if(*ports[p] != node) {
+                continue;
+            }
+            if(row[p] != noPort) {
+                return *ports[row[p]];
+            }
+            found = true;
+        }
+        if(!found) {
+            return std::nullopt;
+        }
+        return NodePtr{};
+    }
 
 };
@@ -58,17 +58,17 @@ struct Block: public Node {
         throw NodeException{"invalid direction given!"};
     }
 
-    NodePtr getJunctionNode(NodePtr node) const {
+    std::optional<NodePtr> findJunctionNode(const NodePtr &node) const {
         if(node == in) {
             return out;
         }
         if(node == out) {
             return in;
         }
-        throw NodeException{"invalid node given!"};
+        return std::nullopt;
     }
 
-    NodePtr getJunctionNode(Direction dir) const {
+    std::optional<NodePtr> findJunctionNode(Direction dir) const {
         // ReSharper disable once CppDefaultCaseNotHandledInSwitchStatement
         switch(dir) {
             case Direction::TOP:
@@ -83,7 +83,7 @@ struct Block: public Node {
             case Direction::TOP_LEFT:
                 return in;
         }
-        throw NodeException{"invalid direction given!"};
+        return std::nullopt;
     }
     
 protected:
@@ -51,26 +51,15 @@ struct CrossOverSwitch: public Node {
         throw NodeException{"invalid direction given!"};
     }
 
-    NodePtr getJunctionNode(NodePtr node) const {
-        if(node != outTop && node != outRight && node != inBottom && node != inLeft) {
-            throw NodeException{"invalid node given!"};
+    std::optional<NodePtr> findJunctionNode(const NodePtr &node) const {
+        const auto row = getActiveRow();
+        if(row == invalidStateRow) {
+            return std::nullopt;
         }
-
-        auto activeIn = getInNode();
-        auto activeOut = getOutNode();
-
-        if(node == activeIn) {
-            return activeOut;
-        }
-
-        if(node == activeOut) {
-            return activeIn;
-        }
-
-        return NodePtr{};
+        return findTransitionNode(getPorts(), CrossOverSwitchNode::transitions[row], node);
     }
 
-    NodePtr getJunctionNode(Direction dir) const {
+    std::optional<NodePtr> findJunctionNode(Direction dir) const {
         switch(dir) {
             case Direction::TOP:
                 return outTop;
@@ -85,12 +74,28 @@ struct CrossOverSwitch: public Node {
                 return inLeft;
 
             default:
-                throw NodeException{"invalid direction given!"};
+                return std::nullopt;
         }
     }
 
     NodePtr getInNode() const {
-        switch(currentState) {
+        auto node = findInNode();
+        if(!node) {
+            throw NodeException{"invalid switch state given!"};
+        }
+        return *node;
+    }
+
+    NodePtr getOutNode() const {
+        auto node = findOutNode();
+        if(!node) {
+            throw NodeException{"invalid switch state given!"};
+        }
+        return *node;
+    }
+
+    std::optional<NodePtr> findInNode() const {
+        switch(currentState.load(std::memory_order_acquire)) {
             case moba::SwitchStand::BEND_1:
             case moba::SwitchStand::BEND_2:
                 return outTop;
@@ -100,12 +105,12 @@ struct CrossOverSwitch: public Node {
                 return outRight;
 
             default:
-                throw NodeException{"invalid switch state given!"};
+                return std::nullopt;
         }
     }
 
-    NodePtr getOutNode() const {
-        switch(currentState) {
+    std::optional<NodePtr> findOutNode() const {
+        switch(currentState.load(std::memory_order_acquire)) {
             case moba::SwitchStand::BEND_1:
             case moba::SwitchStand::STRAIGHT_1:
                 return inBottom;
@@ -113,8 +118,10 @@ struct CrossOverSwitch: public Node {
             case moba::SwitchStand::BEND_2:
             case moba::SwitchStand::STRAIGHT_2:
                 return inLeft;
+
+            default:
+                return std::nullopt;
         }
-        throw NodeException{"invalid switch state given!"};
     }
 
 protected:
@@ -122,4 +129,9 @@ protected:
     NodePtr outRight;
     NodePtr inBottom;
     NodePtr inLeft;
+
+    // Reihenfolge der Anschlüsse wie CrossOverSwitchNode
+    std::array<const NodePtr*, CrossOverSwitchNode::portsCount> getPorts() const {
+        return {&inBottom, &inLeft, &outTop, &outRight};
+    }
 };
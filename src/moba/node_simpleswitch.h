@@ -49,49 +49,11 @@ struct SimpleSwitch: public Node {
         }
     }
 
-    NodePtr getJunctionNode(NodePtr node) const {
-        if(node != in && node != outStraight && node != outBend) {
-            throw NodeException{"invalid node given!"};
-        }
-        if(
-            node == outStraight && (
-                currentState == moba::SwitchStand::STRAIGHT_1 || 
-                currentState == moba::SwitchStand::STRAIGHT_2
-            )
-        ) {
-            return in;
-        }
-        
-        if(
-            node == outBend && (
-                currentState == moba::SwitchStand::BEND_1 || 
-                currentState == moba::SwitchStand::BEND_2
-            )
-        ) {
-            return in;
-        }
-        
-        if(
-            node == in && (
-                currentState == moba::SwitchStand::BEND_1 ||
-                currentState == moba::SwitchStand::BEND_2
-            )
-        ) {
-            return outBend;
-        }
-        
-        if(
-            node == in && (
-                currentState == moba::SwitchStand::STRAIGHT_1 ||
-                currentState == moba::SwitchStand::STRAIGHT_2
-            )
-        ) {
-            return outStraight;
-        }
-        return NodePtr{};
+    std::optional<NodePtr> findJunctionNode(const NodePtr &node) const {
+        return findTransitionNode(getPorts(), SimpleSwitchNode::transitions[getActiveRow()], node);
     }
 
-    NodePtr getJunctionNode(Direction dir) const {
+    std::optional<NodePtr> findJunctionNode(Direction dir) const {
         switch(dir) {
             case Direction::TOP:
                 return outStraight;
@@ -104,7 +66,7 @@ struct SimpleSwitch: public Node {
                 return in;
 
             default:
-                throw NodeException{"invalid direction given!"};
+                return std::nullopt;
         }
     }
     
@@ -112,4 +74,9 @@ protected:
     NodePtr in;
     NodePtr outStraight;
     NodePtr outBend;
+
+    // Reihenfolge der Anschlüsse wie SimpleSwitchNode
+    std::array<const NodePtr*, SimpleSwitchNode::portsCount> getPorts() const {
+        return {&in, &outStraight, &outBend};
+    }
 };
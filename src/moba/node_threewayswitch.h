@@ -50,47 +50,11 @@ struct ThreeWaySwitch: public Node {
         throw NodeException{"invalid direction given!"};
     }
 
-    NodePtr getJunctionNode(NodePtr node) const {
-        if(
-            node != in && node != outStraight && 
-            node != outBendLeft && node != outBendRight
-        ) {
-            throw NodeException{"invalid node given!"};
-        }
-
-        if(node == in && currentState == moba::SwitchStand::BEND_2) {
-            return outBendLeft;
-        }
-
-        if(node == in && currentState == moba::SwitchStand::BEND_1) {
-            return outBendRight;
-        }
-
-        if(node == in) {
-            return outStraight;
-        }
-
-        if(node == outBendLeft && currentState == moba::SwitchStand::BEND_2) {
-            return in;
-        }
-
-        if(node == outBendRight && currentState == moba::SwitchStand::BEND_1) {
-            return in;
-        }
-
-        if(
-            node == outStraight && (
-                currentState == moba::SwitchStand::STRAIGHT_1 ||
-                currentState == moba::SwitchStand::STRAIGHT_2
-            )
-        ) {
-            return in;
-        }
-
-        return NodePtr{};
+    std::optional<NodePtr> findJunctionNode(const NodePtr &node) const {
+        return findTransitionNode(getPorts(), ThreeWaySwitchNode::transitions[getActiveRow()], node);
     }
 
-    NodePtr getJunctionNode(Direction dir) const {
+    std::optional<NodePtr> findJunctionNode(Direction dir) const {
         switch(dir) {
             case Direction::TOP:
                 return outStraight;
@@ -104,7 +68,7 @@ struct ThreeWaySwitch: public Node {
             case Direction::BOTTOM:
                 return in;
         }
-        throw NodeException{"invalid direction given!"};
+        return std::nullopt;
     }
 
 protected:
@@ -112,4 +76,9 @@ protected:
     NodePtr outStraight;
     NodePtr outBendLeft;
     NodePtr outBendRight;
+
+    // Reihenfolge der Anschlüsse wie ThreeWaySwitchNode
+    std::array<const NodePtr*, ThreeWaySwitchNode::portsCount> getPorts() const {
+        return {&in, &outStraight, &outBendLeft, &outBendRight};
+    }
 };
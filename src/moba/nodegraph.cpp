@@ -0,0 +1,280 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#include "nodegraph.h"
+
+namespace {
+
+    // prozessweit, damit auch neu aufgebaute oder verschobene Graphen nie eine alte Version erhalten
+    std::atomic<std::uint64_t> lastTopologyVersion{0};
+}
+
+NodeGraph::NodeGraph(NodeGraph &&other) noexcept:
+nodes{std::move(other.nodes)}, ids{std::move(other.ids)}, states{std::move(other.states)},
+linkNodes{std::move(other.linkNodes)}, linkPorts{std::move(other.linkPorts)},
+index{std::move(other.index)}, anchor{std::move(other.anchor)}, adapters{std::move(other.adapters)} {
+    other.topologyVersion = nextTopologyVersion();
+    if(anchor) {
+        anchor->graph = this;
+    }
+}
+
+NodeGraph& NodeGraph::operator=(NodeGraph &&other) noexcept {
+    if(this == &other) {
+        return *this;
+    }
+    detachAdapters();
+
+    nodes = std::move(other.nodes);
+    ids = std::move(other.ids);
+    states = std::move(other.states);
+    linkNodes = std::move(other.linkNodes);
+    linkPorts = std::move(other.linkPorts);
+    index = std::move(other.index);
+    anchor = std::move(other.anchor);
+    adapters = std::move(other.adapters);
+    topologyVersion = nextTopologyVersion();
+    other.topologyVersion = nextTopologyVersion();
+    if(anchor) {
+        anchor->graph = this;
+    }
+    return *this;
+}
+
+NodeGraph::~NodeGraph() noexcept {
+    detachAdapters();
+}
+
+std::uint64_t NodeGraph::nextTopologyVersion() noexcept {
+    return lastTopologyVersion.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void NodeGraph::detachAdapters() noexcept {
+    if(anchor) {
+        anchor->graph = nullptr;
+    }
+}
+
+NodeId NodeGraph::addNode(NodeKind kind, unsigned int id, moba::SwitchStand state) {
+    const auto node = static_cast<NodeId>(nodes.size());
+
+    if(!index.try_emplace(id, node).second) {
+        throw NodeException{"node id already in use"};
+    }
+
+    nodes.push_back(makeNodeVariant(kind));
+    ids.push_back(id);
+    states.push_back(state);
+
+    linkNodes.resize(linkNodes.size() + maxPorts, invalidNodeId);
+    linkPorts.resize(linkPorts.size() + maxPorts, noPort);
+
+    if(!anchor) {
+        anchor = std::make_shared<Anchor>(this);
+    }
+    adapters.push_back(std::make_shared<NodeAdapter>(*this, node));
+
+    topologyVersion = nextTopologyVersion();
+    return node;
+}
+
+void NodeGraph::reserve(std::size_t count) {
+    nodes.reserve(count);
+    ids.reserve(count);
+    states.reserve(count);
+    linkNodes.reserve(count * maxPorts);
+    linkPorts.reserve(count * maxPorts);
+    index.reserve(count);
+    adapters.reserve(count);
+}
+
+std::optional<NodeGraph::Port> NodeGraph::findPort(NodeKind kind, Direction dir) {
+    return std::visit([dir](auto node) {
+        return node.findPort(dir);
+    }, makeNodeVariant(kind));
+}
+
+std::size_t NodeGraph::getPortsCount(NodeKind kind) {
+    return std::visit([](auto node) {
+        return node.portsCount;
+    }, makeNodeVariant(kind));
+}
+
+NodeGraph::Port NodeGraph::getPort(NodeId node, Direction dir) const {
+    auto port = findPort(getNodeKind(nodes.at(node)), dir);
+    if(!port) {
+        throw NodeException{"invalid direction given!"};
+    }
+    return *port;
+}
+
+void NodeGraph::connect(NodeId a, Port portA, NodeId b, Port portB) {
+    if(portA >= getPortsCount(getNodeKind(nodes.at(a))) || portB >= getPortsCount(getNodeKind(nodes.at(b)))) {
+        throw NodeException{"invalid port given!"};
+    }
+    unlink(a, portA);
+    unlink(b, portB);
+
+    linkNodes[a * maxPorts + portA] = b;
+    linkPorts[a * maxPorts + portA] = portB;
+    linkNodes[b * maxPorts + portB] = a;
+    linkPorts[b * maxPorts + portB] = portA;
+    topologyVersion = nextTopologyVersion();
+}
+
+void NodeGraph::connect(NodeId a, Direction dirA, NodeId b, Direction dirB) {
+    connect(a, getPort(a, dirA), b, getPort(b, dirB));
+}
+
+void NodeGraph::disconnect(NodeId node, Port port) {
+    unlink(node, port);
+    topologyVersion = nextTopologyVersion();
+}
+
+void NodeGraph::unlink(NodeId node, Port port) {
+    const auto idx = node * maxPorts + port;
+    const auto target = linkNodes[idx];
+    const auto targetPort = linkPorts[idx];
+
+    if(target != invalidNodeId && targetPort != noPort) {
+        const auto back = target * maxPorts + targetPort;
+        if(linkNodes[back] == node && linkPorts[back] == port) {
+            linkNodes[back] = invalidNodeId;
+            linkPorts[back] = noPort;
+        }
+    }
+    linkNodes[idx] = invalidNodeId;
+    linkPorts[idx] = noPort;
+}
+
+void NodeGraph::setJunctionNode(NodeId node, Direction dir, NodeId target) {
+    const auto port = getPort(node, dir);
+    const auto idx = node * maxPorts + port;
+
+    unlink(node, port);
+    topologyVersion = nextTopologyVersion();
+
+    if(target == invalidNodeId) {
+        return;
+    }
+    linkNodes[idx] = target;
+
+    for(Port p = 0; p < getPortsCount(getNodeKind(nodes.at(target))); ++p) {
+        const auto back = target * maxPorts + p;
+        if(linkNodes[back] == node && linkPorts[back] == noPort && back != idx) {
+            linkPorts[back] = port;
+            linkPorts[idx] = p;
+            return;
+        }
+    }
+}
+
+std::optional<NodeId> NodeGraph::findNode(unsigned int id) const {
+    auto iter = index.find(id);
+    if(iter == index.end()) {
+        return std::nullopt;
+    }
+    return iter->second;
+}
+
+bool NodeGraph::compareAndTurn(NodeId node, moba::SwitchStand expected, moba::SwitchStand desired) {
+    return std::atomic_ref{states[node]}.compare_exchange_strong(
+        expected, desired, std::memory_order_acq_rel, std::memory_order_acquire
+    );
+}
+
+std::optional<NodeId> NodeGraph::findJunctionNode(NodeId node, Direction dir) const {
+    const auto port = findPort(getNodeKind(nodes.at(node)), dir);
+    if(!port) {
+        return std::nullopt;
+    }
+    return linkNodes[node * maxPorts + *port];
+}
+
+std::optional<NodeId> NodeGraph::findJunctionNode(NodeId node, NodeId from) const {
+    const auto kind = getNodeKind(nodes.at(node));
+    const auto stateRow = getStateRow(getState(node));
+
+    if(kind == NodeKind::CROSS_OVER_SWITCH && stateRow == invalidStateRow) {
+        return std::nullopt;
+    }
+    const auto &row = nodeTransitions[static_cast<std::size_t>(kind)][stateRow];
+
+    bool found = false;
+    for(Port p = 0; p < getPortsCount(kind); ++p) {
+        if(linkNodes[node * maxPorts + p] != from) {
+            continue;
+        }
+        if(row[p] != noPort) {
+            return linkNodes[node * maxPorts + row[p]];
+        }
+        found = true;
+    }
+    if(!found) {
+        return std::nullopt;
+    }
+    return invalidNodeId;
+}
+
+NodePtr NodeGraph::getNode(NodeId node) const {
+    if(node >= adapters.size()) {
+        throw NodeException{"invalid node given!"};
+    }
+    return adapters[node];
+}
+
+NodeId NodeGraph::NodeAdapter::getNodeId(const NodePtr &ptr) const {
+    auto adapter = dynamic_cast<const NodeAdapter*>(ptr.get());
+    if(!adapter || adapter->anchor != anchor) {
+        return invalidNodeId;
+    }
+    return adapter->node;
+}
+
+std::optional<NodePtr> NodeGraph::NodeAdapter::findJunctionNode(const NodePtr &from) const {
+    const auto id = getNodeId(from);
+    if(id == invalidNodeId) {
+        return std::nullopt;
+    }
+    auto next = getGraph().findJunctionNode(node, id);
+    if(!next) {
+        return std::nullopt;
+    }
+    return getNode(*next);
+}
+
+std::optional<NodePtr> NodeGraph::NodeAdapter::findJunctionNode(Direction dir) const {
+    auto next = getGraph().findJunctionNode(node, dir);
+    if(!next) {
+        return std::nullopt;
+    }
+    return getNode(*next);
+}
+
+void NodeGraph::NodeAdapter::setJunctionNode(Direction dir, NodePtr target) {
+    NodeId id = invalidNodeId;
+    if(target) {
+        id = getNodeId(target);
+        if(id == invalidNodeId) {
+            throw NodeException{"node does not belong to this graph!"};
+        }
+    }
+    getGraph().setJunctionNode(node, dir, id);
+}
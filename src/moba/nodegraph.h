@@ -0,0 +1,328 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <moba-common/enumswitchstand.h>
+
+#include "direction.h"
+#include "node.h"
+#include "nodeexception.h"
+#include "nodekinds.h"
+
+using NodeId = std::uint32_t;
+
+inline constexpr NodeId invalidNodeId = std::numeric_limits<NodeId>::max();
+
+/**
+ * Knotengraph in einer Arena: Knoten werden über eine fortlaufende NodeId adressiert,
+ * Eigenschaften und Verbindungen liegen spaltenweise in zusammenhängenden Tabellen.
+ * Verbindungen sind reine Indizes (Zielknoten und Zielanschluss), es gibt also weder
+ * Referenzzähler noch zyklische Besitzverhältnisse. Der Graph gibt beim Zerstören
+ * alles auf einmal frei.
+ *
+ * Die Knotenart wird als NodeVariant (siehe nodekinds.h) per Wert abgelegt. Fahrwege
+ * werden über die Übergangstabellen der Knotenarten aufgelöst: Die Stellung wählt die
+ * Tabellenzeile, der Ausgang ist damit ein einfacher Tabellenzugriff.
+ *
+ * Die Stellung wird atomar (std::atomic_ref, release/acquire) gelesen und geschrieben:
+ * turn und compareAndTurn dürfen ohne Sperre parallel zu Abfragen wie findExit oder
+ * findNext laufen, jede Abfrage liest die Stellung genau einmal. Strukturelle Änderungen
+ * (addNode, connect, ...) dürfen dagegen nicht parallel erfolgen.
+ */
+class NodeGraph {
+public:
+    using Port = NodePort;
+
+    static constexpr std::size_t maxPorts = 4;
+
+    /**
+     * Ein Schritt einer Fahrt: Knoten node, erreicht über den Anschluss entry
+     */
+    struct Step {
+        NodeId node;
+        Port   entry;
+    };
+
+    class NodeAdapter;
+
+    NodeGraph() = default;
+
+    NodeGraph(const NodeGraph&) = delete;
+    NodeGraph(NodeGraph &&other) noexcept;
+
+    NodeGraph& operator=(const NodeGraph&) = delete;
+    NodeGraph& operator=(NodeGraph &&other) noexcept;
+
+    ~NodeGraph() noexcept;
+
+    NodeId addNode(NodeKind kind, unsigned int id, moba::SwitchStand state = moba::SwitchStand::STRAIGHT_1);
+
+    void reserve(std::size_t count);
+
+    [[nodiscard]] std::size_t size() const {
+        return nodes.size();
+    }
+
+    /**
+     * Liefert den Anschluss, über den ein Knoten der Art kind in Richtung dir
+     * angeschlossen wird, oder std::nullopt, wenn es in dieser Richtung keinen gibt
+     */
+    [[nodiscard]] static std::optional<Port> findPort(NodeKind kind, Direction dir);
+
+    [[nodiscard]] static std::size_t getPortsCount(NodeKind kind);
+
+    /**
+     * Verbindet Anschluss portA von a mit Anschluss portB von b (in beide Richtungen)
+     */
+    void connect(NodeId a, Port portA, NodeId b, Port portB);
+
+    void connect(NodeId a, Direction dirA, NodeId b, Direction dirB);
+
+    /**
+     * Trennt die Verbindung an Anschluss port von node samt Gegenseite
+     */
+    void disconnect(NodeId node, Port port);
+
+    /**
+     * Einseitige Verknüpfung wie Node::setJunctionNode. Zeigt der Zielknoten bereits
+     * über einen noch ungepaarten Anschluss zurück, werden beide Seiten gepaart.
+     */
+    void setJunctionNode(NodeId node, Direction dir, NodeId target);
+
+    [[nodiscard]] NodeKind getKind(NodeId node) const {
+        return getNodeKind(nodes[node]);
+    }
+
+    /**
+     * Ruft f mit der Knotenart von node auf (BlockNode, SimpleSwitchNode, ...)
+     */
+    template<typename F>
+    decltype(auto) visit(NodeId node, F &&f) const {
+        return std::visit(std::forward<F>(f), nodes[node]);
+    }
+
+    [[nodiscard]] unsigned int getId(NodeId node) const {
+        return ids[node];
+    }
+
+    /**
+     * Liefert die NodeId zur (externen) Id eines Knotens
+     */
+    [[nodiscard]] std::optional<NodeId> findNode(unsigned int id) const;
+
+    [[nodiscard]] moba::SwitchStand getState(NodeId node) const {
+        return load(states[node]);
+    }
+
+    void turn(NodeId node, moba::SwitchStand state) {
+        std::atomic_ref{states[node]}.store(state, std::memory_order_release);
+    }
+
+    /**
+     * Stellt node nur dann auf desired, wenn er noch auf expected steht
+     *
+     * @return true, wenn gestellt wurde
+     */
+    bool compareAndTurn(NodeId node, moba::SwitchStand expected, moba::SwitchStand desired);
+
+    /**
+     * Liefert den an Anschluss port angeschlossenen Knoten oder invalidNodeId
+     */
+    [[nodiscard]] NodeId getLinkedNode(NodeId node, Port port) const {
+        return linkNodes[node * maxPorts + port];
+    }
+
+    [[nodiscard]] Port getLinkedPort(NodeId node, Port port) const {
+        return linkPorts[node * maxPorts + port];
+    }
+
+    /**
+     * Liefert den Ausgang bei Einfahrt über entry in der aktuellen Stellung oder
+     * std::nullopt, wenn die Weiche in diese Richtung nicht gestellt ist
+     */
+    [[nodiscard]] std::optional<Port> findExit(NodeId node, Port entry) const {
+        if(entry >= maxPorts) {
+            return std::nullopt;
+        }
+        const auto exit = getActiveRow(node)[entry];
+        if(exit == noPort) {
+            return std::nullopt;
+        }
+        return exit;
+    }
+
+    /**
+     * Folgt dem Gleis durch node (Einfahrt über entry) bis zum nächsten Knoten. Wie
+     * findExit im Header, damit der Aufruf in Fahrschleifen inline aufgelöst wird.
+     */
+    [[nodiscard]] std::optional<Step> findNext(NodeId node, Port entry) const {
+        const auto exit = findExit(node, entry);
+        if(!exit) {
+            return std::nullopt;
+        }
+        const auto idx = node * maxPorts + *exit;
+        if(linkNodes[idx] == invalidNodeId) {
+            return std::nullopt;
+        }
+        return Step{linkNodes[idx], linkPorts[idx]};
+    }
+
+    /**
+     * Wie Node::findJunctionNode(Direction): std::nullopt, wenn node in dieser Richtung
+     * keinen Anschluss hat, sonst den verbundenen Knoten bzw. invalidNodeId
+     */
+    [[nodiscard]] std::optional<NodeId> findJunctionNode(NodeId node, Direction dir) const;
+
+    /**
+     * Wie Node::findJunctionNode(const NodePtr&): std::nullopt, wenn from kein Nachbar ist,
+     * invalidNodeId, wenn die Weiche nicht in diese Richtung gestellt ist
+     */
+    [[nodiscard]] std::optional<NodeId> findJunctionNode(NodeId node, NodeId from) const;
+
+    /**
+     * Erhält bei jeder strukturellen Änderung (Knoten, Verbindungen) sowie beim Verschieben
+     * einen neuen Wert, nicht aber beim Stellen einer Weiche. Die Werte werden prozessweit
+     * vergeben, zwei Graphen bzw. zwei Stände eines Graphen haben nie dieselbe Version.
+     */
+    [[nodiscard]] std::uint64_t getTopologyVersion() const {
+        return topologyVersion;
+    }
+
+    /**
+     * Liefert node über das bisherige Node-Interface. Die Adapter werden von addNode
+     * angelegt, der Zugriff ist daher rein lesend und darf parallel erfolgen. Sie erreichen
+     * den Graphen über einen gemeinsamen Anker und folgen ihm beim Verschieben. Wird der
+     * Graph zerstört oder mit einem anderen überschrieben, wirft jeder weitere Zugriff
+     * über einen zuvor gelieferten Adapter eine NodeException, statt ins Leere zu greifen.
+     */
+    [[nodiscard]] NodePtr getNode(NodeId node) const;
+
+protected:
+    // Knoteneigenschaften
+    std::vector<NodeVariant>       nodes;
+    std::vector<unsigned int>      ids;
+    std::vector<moba::SwitchStand> states;
+
+    // Verbindungen, je Knoten maxPorts Einträge
+    std::vector<NodeId> linkNodes;
+    std::vector<Port>   linkPorts;
+
+    std::unordered_map<unsigned int, NodeId> index;
+
+    /**
+     * Verweis der Adapter auf ihren Graphen; wird beim Verschieben umgesetzt und beim
+     * Zerstören bzw. Überschreiben des Graphen gelöscht
+     */
+    struct Anchor {
+        NodeGraph *graph;
+    };
+
+    std::shared_ptr<Anchor> anchor;
+    std::vector<std::shared_ptr<NodeAdapter>> adapters;
+
+    std::uint64_t topologyVersion = nextTopologyVersion();
+
+    [[nodiscard]] static std::uint64_t nextTopologyVersion() noexcept;
+
+    [[nodiscard]] Port getPort(NodeId node, Direction dir) const;
+
+    static_assert(std::atomic_ref<moba::SwitchStand>::is_always_lock_free);
+
+    template<typename T>
+    static T load(const T &value) {
+        // atomic_ref<const T> gibt es erst mit C++26, gelesen wird nur
+        return std::atomic_ref{const_cast<T&>(value)}.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] const TransitionRow &getActiveRow(NodeId node) const {
+        return nodeTransitions[static_cast<std::size_t>(getKind(node))][getStateRow(getState(node))];
+    }
+
+    void unlink(NodeId node, Port port);
+
+    void detachAdapters() noexcept;
+};
+
+/**
+ * Bildet einen Arena-Knoten auf das Node-Interface ab. Alle Zugriffe gehen direkt
+ * an den Graphen.
+ */
+class NodeGraph::NodeAdapter: public Node {
+public:
+    NodeAdapter(NodeGraph &graph, NodeId node):
+    Node{graph.getId(node), graph.getState(node)}, anchor{graph.anchor}, node{node} {
+    }
+
+    ~NodeAdapter() noexcept override = default;
+
+    std::optional<NodePtr> findJunctionNode(const NodePtr &from) const override;
+
+    std::optional<NodePtr> findJunctionNode(Direction dir) const override;
+
+    void setJunctionNode(Direction dir, NodePtr target) override;
+
+    // die Stellung liegt allein im Graphen
+    void turn(moba::SwitchStand stand) override {
+        getGraph().turn(node, stand);
+    }
+
+    bool compareAndTurn(moba::SwitchStand expected, moba::SwitchStand desired) override {
+        return getGraph().compareAndTurn(node, expected, desired);
+    }
+
+    [[nodiscard]] moba::SwitchStand getState() const override {
+        return getGraph().getState(node);
+    }
+
+    [[nodiscard]] NodeId getNodeId() const {
+        return node;
+    }
+
+protected:
+    std::shared_ptr<const Anchor> anchor;
+    NodeId node;
+
+    NodeGraph &getGraph() const {
+        if(!anchor->graph) {
+            throw NodeException{"graph no longer exists!"};
+        }
+        return *anchor->graph;
+    }
+
+    NodePtr getNode(NodeId target) const {
+        if(target == invalidNodeId) {
+            return NodePtr{};
+        }
+        return getGraph().getNode(target);
+    }
+
+    NodeId getNodeId(const NodePtr &ptr) const;
+};
@@ -0,0 +1,306 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <variant>
+#include <moba-common/enumswitchstand.h>
+
+#include "direction.h"
+
+using NodePort = std::uint8_t;
+
+inline constexpr NodePort noPort = std::numeric_limits<NodePort>::max();
+
+enum class NodeKind: std::uint8_t {
+    BLOCK,
+    SIMPLE_SWITCH,
+    THREE_WAY_SWITCH,
+    CROSS_OVER_SWITCH
+};
+
+/**
+ * Zeilen der Übergangstabellen: eine je Weichenstellung plus eine für ungültige
+ * Stellungen
+ */
+inline constexpr std::size_t stateRowsCount = 5;
+inline constexpr std::size_t invalidStateRow = 4;
+
+constexpr std::size_t getStateRow(moba::SwitchStand state) {
+    switch(state) {
+        case moba::SwitchStand::BEND_1:
+            return 0;
+
+        case moba::SwitchStand::BEND_2:
+            return 1;
+
+        case moba::SwitchStand::STRAIGHT_1:
+            return 2;
+
+        case moba::SwitchStand::STRAIGHT_2:
+            return 3;
+
+        default:
+            return invalidStateRow;
+    }
+}
+
+/**
+ * Umkehrung von getStateRow für die Zeilen 0 bis 3
+ */
+constexpr moba::SwitchStand getRowState(std::size_t row) {
+    switch(row) {
+        case 0:
+            return moba::SwitchStand::BEND_1;
+
+        case 1:
+            return moba::SwitchStand::BEND_2;
+
+        case 3:
+            return moba::SwitchStand::STRAIGHT_2;
+
+        default:
+            return moba::SwitchStand::STRAIGHT_1;
+    }
+}
+
+/**
+ * Ausgang je Einfahrtsanschluss (noPort: in dieser Stellung nicht befahrbar)
+ */
+using TransitionRow = std::array<NodePort, 4>;
+using TransitionTable = std::array<TransitionRow, stateRowsCount>;
+
+/*
+ * Geschlossene Menge der Knotenarten als Werttypen für NodeGraph. Anders als die
+ * Node-Klassen haben sie keine virtuellen Methoden: Die Auswahl erfolgt über den
+ * Index von NodeVariant (std::visit), das Verhalten selbst ist constexpr und kann
+ * vom Compiler eingebettet werden. Anschlüsse und Fahrwege entsprechen Block,
+ * SimpleSwitch, ThreeWaySwitch und CrossOverSwitch; diese nutzen dieselben
+ * Übergangstabellen (transitions, Zeile über getStateRow).
+ */
+
+template<typename Kind>
+constexpr std::optional<NodePort> findTransition(NodePort entry, moba::SwitchStand state) {
+    if(entry >= Kind::portsCount) {
+        return std::nullopt;
+    }
+    const auto exit = Kind::transitions[getStateRow(state)][entry];
+    if(exit == noPort) {
+        return std::nullopt;
+    }
+    return exit;
+}
+
+/**
+ * 0 in, 1 out
+ */
+struct BlockNode {
+    static constexpr NodeKind    kind = NodeKind::BLOCK;
+    static constexpr std::size_t portsCount = 2;
+
+    static constexpr TransitionTable transitions = {{
+        {1, 0, noPort, noPort}, // BEND_1
+        {1, 0, noPort, noPort}, // BEND_2
+        {1, 0, noPort, noPort}, // STRAIGHT_1
+        {1, 0, noPort, noPort}, // STRAIGHT_2
+        {1, 0, noPort, noPort}  // ungültig
+    }};
+
+    static constexpr std::optional<NodePort> findPort(Direction dir) {
+        switch(dir) {
+            case Direction::TOP:
+            case Direction::TOP_RIGHT:
+            case Direction::RIGHT:
+            case Direction::BOTTOM_RIGHT:
+                return 1;
+
+            case Direction::BOTTOM:
+            case Direction::BOTTOM_LEFT:
+            case Direction::LEFT:
+            case Direction::TOP_LEFT:
+                return 0;
+
+            default:
+                return std::nullopt;
+        }
+    }
+
+    static constexpr std::optional<NodePort> findExit(NodePort entry, moba::SwitchStand state) {
+        return findTransition<BlockNode>(entry, state);
+    }
+};
+
+/**
+ * 0 in (BOTTOM), 1 gerade (TOP), 2 abzweigend (TOP_LEFT / TOP_RIGHT)
+ */
+struct SimpleSwitchNode {
+    static constexpr NodeKind    kind = NodeKind::SIMPLE_SWITCH;
+    static constexpr std::size_t portsCount = 3;
+
+    static constexpr TransitionTable transitions = {{
+        {2,      noPort, 0,      noPort}, // BEND_1
+        {2,      noPort, 0,      noPort}, // BEND_2
+        {1,      0,      noPort, noPort}, // STRAIGHT_1
+        {1,      0,      noPort, noPort}, // STRAIGHT_2
+        {noPort, noPort, noPort, noPort}  // ungültig
+    }};
+
+    static constexpr std::optional<NodePort> findPort(Direction dir) {
+        switch(dir) {
+            case Direction::BOTTOM:
+                return 0;
+
+            case Direction::TOP:
+                return 1;
+
+            case Direction::TOP_LEFT:
+            case Direction::TOP_RIGHT:
+                return 2;
+
+            default:
+                return std::nullopt;
+        }
+    }
+
+    static constexpr std::optional<NodePort> findExit(NodePort entry, moba::SwitchStand state) {
+        return findTransition<SimpleSwitchNode>(entry, state);
+    }
+};
+
+/**
+ * 0 in (BOTTOM), 1 gerade (TOP), 2 links (TOP_LEFT), 3 rechts (TOP_RIGHT)
+ */
+struct ThreeWaySwitchNode {
+    static constexpr NodeKind    kind = NodeKind::THREE_WAY_SWITCH;
+    static constexpr std::size_t portsCount = 4;
+
+    static constexpr TransitionTable transitions = {{
+        {3, noPort, noPort, 0     }, // BEND_1
+        {2, noPort, 0,      noPort}, // BEND_2
+        {1, 0,      noPort, noPort}, // STRAIGHT_1
+        {1, 0,      noPort, noPort}, // STRAIGHT_2
+        {1, noPort, noPort, noPort}  // ungültig: von "in" geht es geradeaus
+    }};
+
+    static constexpr std::optional<NodePort> findPort(Direction dir) {
+        switch(dir) {
+            case Direction::BOTTOM:
+                return 0;
+
+            case Direction::TOP:
+                return 1;
+
+            case Direction::TOP_LEFT:
+                return 2;
+
+            case Direction::TOP_RIGHT:
+                return 3;
+
+            default:
+                return std::nullopt;
+        }
+    }
+
+    static constexpr std::optional<NodePort> findExit(NodePort entry, moba::SwitchStand state) {
+        return findTransition<ThreeWaySwitchNode>(entry, state);
+    }
+};
+
+/**
+ * 0 unten (BOTTOM), 1 links (BOTTOM_LEFT), 2 oben (TOP), 3 rechts (TOP_RIGHT)
+ */
+struct CrossOverSwitchNode {
+    static constexpr NodeKind    kind = NodeKind::CROSS_OVER_SWITCH;
+    static constexpr std::size_t portsCount = 4;
+
+    static constexpr TransitionTable transitions = {{
+        {2,      noPort, 0,      noPort}, // BEND_1:     oben  <-> unten
+        {noPort, 2,      1,      noPort}, // BEND_2:     oben  <-> links
+        {3,      noPort, noPort, 0     }, // STRAIGHT_1: rechts <-> unten
+        {noPort, 3,      noPort, 1     }, // STRAIGHT_2: rechts <-> links
+        {noPort, noPort, noPort, noPort}  // ungültig
+    }};
+
+    static constexpr std::optional<NodePort> findPort(Direction dir) {
+        switch(dir) {
+            case Direction::BOTTOM:
+                return 0;
+
+            case Direction::BOTTOM_LEFT:
+                return 1;
+
+            case Direction::TOP:
+                return 2;
+
+            case Direction::TOP_RIGHT:
+                return 3;
+
+            default:
+                return std::nullopt;
+        }
+    }
+
+    static constexpr std::optional<NodePort> findExit(NodePort entry, moba::SwitchStand state) {
+        return findTransition<CrossOverSwitchNode>(entry, state);
+    }
+};
+
+/**
+ * Reihenfolge entspricht NodeKind, d.h. NodeVariant::index() == NodeKind
+ */
+using NodeVariant = std::variant<BlockNode, SimpleSwitchNode, ThreeWaySwitchNode, CrossOverSwitchNode>;
+
+static_assert(std::variant_alternative_t<static_cast<std::size_t>(NodeKind::BLOCK), NodeVariant>::kind == NodeKind::BLOCK);
+static_assert(std::variant_alternative_t<static_cast<std::size_t>(NodeKind::SIMPLE_SWITCH), NodeVariant>::kind == NodeKind::SIMPLE_SWITCH);
+static_assert(std::variant_alternative_t<static_cast<std::size_t>(NodeKind::THREE_WAY_SWITCH), NodeVariant>::kind == NodeKind::THREE_WAY_SWITCH);
+static_assert(std::variant_alternative_t<static_cast<std::size_t>(NodeKind::CROSS_OVER_SWITCH), NodeVariant>::kind == NodeKind::CROSS_OVER_SWITCH);
+
+constexpr NodeVariant makeNodeVariant(NodeKind kind) {
+    switch(kind) {
+        case NodeKind::SIMPLE_SWITCH:
+            return SimpleSwitchNode{};
+
+        case NodeKind::THREE_WAY_SWITCH:
+            return ThreeWaySwitchNode{};
+
+        case NodeKind::CROSS_OVER_SWITCH:
+            return CrossOverSwitchNode{};
+
+        default:
+            return BlockNode{};
+    }
+}
+
+constexpr NodeKind getNodeKind(const NodeVariant &node) {
+    return static_cast<NodeKind>(node.index());
+}
+
+/**
+ * Übergangstabellen aller Knotenarten, indiziert über NodeKind
+ */
+inline constexpr std::array<TransitionTable, 4> nodeTransitions = {
+    BlockNode::transitions, SimpleSwitchNode::transitions,
+    ThreeWaySwitchNode::transitions, CrossOverSwitchNode::transitions
+};
@@ -0,0 +1,123 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+#include "direction.h"
+#include "position.h"
+
+/**
+ * Kompakte Position aus zwei vorzeichenbehafteten 32-Bit-Koordinaten. Sie lässt sich
+ * verlustfrei in einen einzelnen 64-Bit-Schlüssel packen, dessen Sortierung der
+ * zeilenweisen Sortierung von Position entspricht (Zeile, dann Spalte).
+ */
+struct PackedPosition {
+    constexpr PackedPosition(): x{0}, y{0} {
+    }
+
+    constexpr PackedPosition(std::int32_t x, std::int32_t y): x{x}, y{y} {
+    }
+
+    /**
+     * @throws std::out_of_range wenn pos nicht in 32 Bit passt
+     */
+    constexpr explicit PackedPosition(const Position &pos) {
+        if(!fits(pos)) {
+            throw std::out_of_range{"position exceeds 32 bit"};
+        }
+        x = static_cast<std::int32_t>(pos.x);
+        y = static_cast<std::int32_t>(pos.y);
+    }
+
+    std::int32_t x;
+    std::int32_t y;
+
+    static constexpr bool fits(const Position &pos) {
+        constexpr auto max = static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max());
+        return pos.x <= max && pos.y <= max;
+    }
+
+    /**
+     * Packt die Position in einen 64-Bit-Schlüssel. Durch das Kippen des Vorzeichenbits
+     * bleibt die Sortierung auch für negative Koordinaten erhalten.
+     */
+    [[nodiscard]] constexpr std::uint64_t getKey() const {
+        return static_cast<std::uint64_t>(static_cast<std::uint32_t>(y) ^ SIGN) << 32 |
+            (static_cast<std::uint32_t>(x) ^ SIGN);
+    }
+
+    static constexpr PackedPosition fromKey(std::uint64_t key) {
+        return {
+            static_cast<std::int32_t>(static_cast<std::uint32_t>(key) ^ SIGN),
+            static_cast<std::int32_t>(static_cast<std::uint32_t>(key >> 32) ^ SIGN)
+        };
+    }
+
+    /**
+     * Liefert die Nachbarposition in Richtung d über die Versatztabelle von Direction oder
+     * std::nullopt, wenn der Wertebereich verlassen würde
+     */
+    [[nodiscard]] constexpr std::optional<PackedPosition> step(Direction d) const {
+        const auto delta = d.getDelta();
+        const auto nx = static_cast<std::int64_t>(x) + delta.x;
+        const auto ny = static_cast<std::int64_t>(y) + delta.y;
+
+        if(
+            nx < std::numeric_limits<std::int32_t>::min() || nx > std::numeric_limits<std::int32_t>::max() ||
+            ny < std::numeric_limits<std::int32_t>::min() || ny > std::numeric_limits<std::int32_t>::max()
+        ) {
+            return std::nullopt;
+        }
+        return PackedPosition{static_cast<std::int32_t>(nx), static_cast<std::int32_t>(ny)};
+    }
+
+    /**
+     * Wandelt in eine Position um; std::nullopt bei negativen Koordinaten
+     */
+    [[nodiscard]] constexpr std::optional<Position> toPosition() const {
+        if(x < 0 || y < 0) {
+            return std::nullopt;
+        }
+        return Position{static_cast<std::size_t>(x), static_cast<std::size_t>(y)};
+    }
+
+    friend constexpr bool operator==(const PackedPosition &lhs, const PackedPosition &rhs) {
+        return lhs.x == rhs.x && lhs.y == rhs.y;
+    }
+
+    friend constexpr bool operator<(const PackedPosition &lhs, const PackedPosition &rhs) {
+        return lhs.getKey() < rhs.getKey();
+    }
+
+protected:
+    static constexpr std::uint32_t SIGN = 0x80000000;
+};
+
+static_assert(sizeof(PackedPosition) == 8);
+static_assert(PackedPosition{-1, 0}.getKey() < PackedPosition{0, 0}.getKey());
+static_assert(PackedPosition{5, 0}.getKey() < PackedPosition{0, 1}.getKey());
+static_assert(PackedPosition::fromKey(PackedPosition{-7, 42}.getKey()) == PackedPosition{-7, 42});
+static_assert(*PackedPosition{3, 3}.step(Direction::TOP_LEFT) == PackedPosition{2, 2});
+static_assert(!PackedPosition{std::numeric_limits<std::int32_t>::max(), 0}.step(Direction::RIGHT));
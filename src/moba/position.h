@@ -22,6 +22,7 @@
 
 #include <cstddef>
 #include <iostream>
+#include <optional>
 
 #include "direction.h"
 
@@ -88,43 +89,25 @@ struct Position {
 
     /**
      * setzt den Cursor (Position) in die Richtung welche mit Direction
-     * angegeben ist. Beispiel: Direction RIGHT -> x einen weiter nach rechts
+     * angegeben ist. Beispiel: Direction RIGHT -> x einen weiter nach rechts.
+     * Am linken bzw. oberen Rand läuft die Koordinate über (siehe step)
      * @param d
      */
     void setNewPosition(Direction d) {
-        switch(d) {
-            case Direction::UNSET:
-                return;
-
-            case Direction::TOP_RIGHT:
-                x++;  // fall-through
-
-            case Direction::TOP:
-                y--;
-                break;
-
-            case Direction::BOTTOM_RIGHT:
-                y++; // fall-through
-
-            case Direction::RIGHT:
-                x++;
-                return;
-
-            case Direction::BOTTOM:
-                y++;
-                return;
-
-            case Direction::BOTTOM_LEFT:
-                y++;  // fall-through
-
-            case Direction::LEFT:
-                x--;
-                break;
+        const auto delta = d.getDelta();
+        x += static_cast<std::size_t>(delta.x);
+        y += static_cast<std::size_t>(delta.y);
+    }
 
-            case Direction::TOP_LEFT:
-                y--;
-                x--;
-                break;
+    /**
+     * Liefert die Nachbarposition in Richtung d oder std::nullopt, wenn diese links
+     * bzw. oberhalb des Rasters läge
+     */
+    [[nodiscard]] constexpr std::optional<Position> step(Direction d) const {
+        const auto delta = d.getDelta();
+        if((delta.x < 0 && x == 0) || (delta.y < 0 && y == 0)) {
+            return std::nullopt;
         }
+        return Position{x + static_cast<std::size_t>(delta.x), y + static_cast<std::size_t>(delta.y)};
     }
 };
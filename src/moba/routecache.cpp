@@ -0,0 +1,97 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#include "routecache.h"
+
+#include <utility>
+
+RouteCache::RouteCache(const NodeGraph &graph, std::size_t capacity, std::vector<unsigned int> weights):
+graph{graph}, capacity{capacity}, weights{std::move(weights)}, finder{graph}, topologyVersion{graph.getTopologyVersion()} {
+    if(!capacity) {
+        throw RouteFinderException{"capacity must not be zero"};
+    }
+    index.reserve(capacity);
+}
+
+RouteCache::RoutePtr RouteCache::getRoute(unsigned int from, unsigned int to, std::optional<NodeGraph::Port> exit) {
+    std::lock_guard<std::mutex> lock{mutex};
+    return getRoute(Key{from, to, exit ? *exit : anyExit});
+}
+
+void RouteCache::precompute(const std::vector<unsigned int> &blocks, std::stop_token stop) {
+    std::size_t count = 0;
+    for(const auto from: blocks) {
+        for(const auto to: blocks) {
+            for(const auto exit: {NodeGraph::Port{0}, NodeGraph::Port{1}, anyExit}) {
+                if(stop.stop_requested() || count++ == capacity) {
+                    return;
+                }
+                std::lock_guard<std::mutex> lock{mutex};
+                getRoute(Key{from, to, exit});
+            }
+        }
+    }
+}
+
+void RouteCache::clear() {
+    std::lock_guard<std::mutex> lock{mutex};
+    entries.clear();
+    index.clear();
+}
+
+std::size_t RouteCache::size() const {
+    std::lock_guard<std::mutex> lock{mutex};
+    return entries.size();
+}
+
+void RouteCache::checkTopology() {
+    const auto version = graph.getTopologyVersion();
+    if(version == topologyVersion) {
+        return;
+    }
+    entries.clear();
+    index.clear();
+    topologyVersion = version;
+}
+
+RouteCache::RoutePtr RouteCache::getRoute(const Key &key) {
+    checkTopology();
+
+    if(auto iter = index.find(key); iter != index.end()) {
+        entries.splice(entries.begin(), entries, iter->second);
+        return iter->second->route;
+    }
+
+    const auto exit = key.exit == anyExit ? std::nullopt : std::optional<NodeGraph::Port>{key.exit};
+    auto route = weights.empty() ? finder.findRoute(key.from, key.to, exit) : finder.findRoute(key.from, key.to, exit, weights);
+
+    RoutePtr ptr;
+    if(route) {
+        ptr = std::make_shared<const Route>(std::move(*route));
+    }
+
+    if(entries.size() == capacity) {
+        index.erase(entries.back().key);
+        entries.pop_back();
+    }
+    entries.push_front({key, ptr});
+    index.emplace(key, entries.begin());
+    return ptr;
+}
@@ -0,0 +1,117 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <unordered_map>
+#include <vector>
+
+#include "nodegraph.h"
+#include "routefinder.h"
+
+/**
+ * Zwischenspeicher für Fahrstraßen, Schlüssel ist (Startblock, Zielblock, Ausfahrt).
+ * Einträge werden bei Bedarf berechnet oder per precompute vorab gefüllt, auch
+ * "keine Fahrstraße" wird gespeichert. Der Speicher ist auf capacity Einträge begrenzt,
+ * verdrängt wird der am längsten nicht benutzte Eintrag (LRU).
+ *
+ * Da Fahrstraßen unabhängig von der aktuellen Weichenstellung sind, bleibt der Inhalt
+ * beim Stellen von Weichen gültig. Ändert sich dagegen die Struktur des Graphen (siehe
+ * NodeGraph::getTopologyVersion), wird beim nächsten Zugriff alles verworfen.
+ *
+ * Alle Methoden dürfen aus mehreren Threads aufgerufen werden (z.B. precompute in einem
+ * eigenen Thread), Suchen laufen dabei nacheinander. Strukturelle Änderungen am Graphen
+ * müssen wie bisher ohne gleichzeitige Zugriffe erfolgen.
+ */
+class RouteCache {
+public:
+    using RoutePtr = std::shared_ptr<const Route>;
+
+    /**
+     * @param weights Gewicht je NodeId wie bei RouteFinder, leer für Anzahl der Knoten
+     */
+    explicit RouteCache(const NodeGraph &graph, std::size_t capacity = 4096, std::vector<unsigned int> weights = {});
+
+    /**
+     * Liefert die Fahrstraße oder einen leeren Zeiger, wenn es keine gibt
+     */
+    RoutePtr getRoute(unsigned int from, unsigned int to, std::optional<NodeGraph::Port> exit = std::nullopt);
+
+    /**
+     * Berechnet alle Fahrstraßen zwischen den Blöcken blocks (je Ausfahrt), höchstens
+     * jedoch capacity viele. Kann über stop abgebrochen werden, etwa aus einem std::jthread.
+     */
+    void precompute(const std::vector<unsigned int> &blocks, std::stop_token stop = {});
+
+    void clear();
+
+    [[nodiscard]] std::size_t size() const;
+
+    [[nodiscard]] std::size_t getCapacity() const {
+        return capacity;
+    }
+
+protected:
+    struct Key {
+        unsigned int from;
+        unsigned int to;
+        std::uint8_t exit; // Anschluss oder anyExit
+
+        friend bool operator==(const Key&, const Key&) = default;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const noexcept {
+            const auto value = (static_cast<std::uint64_t>(key.from) << 32 | key.to) * 0x9E3779B97F4A7C15ull;
+            return static_cast<std::size_t>(value ^ value >> 29 ^ key.exit);
+        }
+    };
+
+    struct Entry {
+        Key      key;
+        RoutePtr route;
+    };
+
+    static constexpr std::uint8_t anyExit = noPort;
+
+    const NodeGraph &graph;
+    const std::size_t capacity;
+    const std::vector<unsigned int> weights;
+
+    mutable std::mutex mutex;
+
+    RouteFinder finder;
+    std::uint64_t topologyVersion;
+
+    // vorne der zuletzt benutzte Eintrag
+    std::list<Entry> entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+
+    void checkTopology();
+
+    RoutePtr getRoute(const Key &key);
+};
@@ -0,0 +1,316 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#include "routefinder.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <functional>
+#include <unordered_map>
+
+namespace {
+
+    /**
+     * Möglicher Ausgang bei gegebener Einfahrt samt der Stellungen (Tabellenzeilen), die ihn
+     * herstellen
+     */
+    struct RouteChoice {
+        NodePort     exit;
+        std::uint8_t rows;
+    };
+
+    struct RouteChoices {
+        std::array<RouteChoice, NodeGraph::maxPorts> items;
+        std::size_t count;
+    };
+
+    constexpr std::size_t stateCount = 4;
+
+    constexpr auto makeRouteChoices() {
+        std::array<std::array<RouteChoices, NodeGraph::maxPorts>, nodeTransitions.size()> result{};
+
+        for(std::size_t kind = 0; kind < nodeTransitions.size(); ++kind) {
+            for(std::size_t entry = 0; entry < NodeGraph::maxPorts; ++entry) {
+                auto &choices = result[kind][entry];
+                for(std::size_t row = 0; row < stateCount; ++row) {
+                    const auto exit = nodeTransitions[kind][row][entry];
+                    if(exit == noPort) {
+                        continue;
+                    }
+                    auto iter = std::find_if(choices.items.begin(), choices.items.begin() + choices.count, [exit](const auto &c) {
+                        return c.exit == exit;
+                    });
+                    if(iter == choices.items.begin() + choices.count) {
+                        choices.items[choices.count++] = {exit, 0};
+                        iter = choices.items.begin() + choices.count - 1;
+                    }
+                    iter->rows |= 1 << row;
+                }
+            }
+        }
+        return result;
+    }
+
+    // je Knotenart und Einfahrtsanschluss alle erreichbaren Ausgänge
+    constexpr auto routeChoices = makeRouteChoices();
+
+    constexpr std::uint8_t allRows = (1 << stateCount) - 1;
+}
+
+std::optional<Route> RouteFinder::findRoute(unsigned int from, unsigned int to, std::optional<NodeGraph::Port> exit) {
+    const auto [start, target] = getBlocks(from, to, exit);
+    return search(start, target, exit, [](NodeId) {
+        return 1u;
+    });
+}
+
+std::optional<Route> RouteFinder::findRoute(
+    unsigned int from, unsigned int to, std::optional<NodeGraph::Port> exit, const std::vector<unsigned int> &weights
+) {
+    if(weights.size() < graph.size()) {
+        throw RouteFinderException{"missing node weights"};
+    }
+    const auto [start, target] = getBlocks(from, to, exit);
+    return search(start, target, exit, [&weights](NodeId node) {
+        return weights[node];
+    });
+}
+
+std::pair<NodeId, NodeId> RouteFinder::getBlocks(unsigned int from, unsigned int to, std::optional<NodeGraph::Port> exit) const {
+    const auto start = graph.findNode(from);
+    const auto target = graph.findNode(to);
+
+    if(!start || !target) {
+        throw RouteFinderException{"unknown node id given"};
+    }
+    if(graph.getKind(*start) != NodeKind::BLOCK || graph.getKind(*target) != NodeKind::BLOCK) {
+        throw RouteFinderException{"route must start and end at a block"};
+    }
+    if(exit && *exit >= BlockNode::portsCount) {
+        throw RouteFinderException{"invalid exit given"};
+    }
+    return {*start, *target};
+}
+
+void RouteFinder::prepare() {
+    labels.resize(graph.size() * NodeGraph::maxPorts);
+    entries.resize(graph.size());
+    entriesStamp.resize(graph.size());
+    heap.clear();
+
+    // Stempel statt Löschen; beim Überlauf einmal alles zurücksetzen
+    if(++generation == 0) {
+        std::fill(labels.begin(), labels.end(), Label{});
+        std::fill(entriesStamp.begin(), entriesStamp.end(), 0);
+        generation = 1;
+    }
+}
+
+template<typename Weight>
+std::optional<Route> RouteFinder::search(NodeId start, NodeId target, std::optional<NodeGraph::Port> exit, Weight weight) {
+    prepare();
+
+    if(start == target) {
+        return Route{{start}, {graph.getId(start)}, {}, 0, {{start / 64, std::uint64_t{1} << start % 64}}, {}};
+    }
+
+    for(NodeGraph::Port port = 0; port < BlockNode::portsCount; ++port) {
+        if(exit && *exit != port) {
+            continue;
+        }
+        const auto next = graph.getLinkedNode(start, port);
+        const auto nextEntry = graph.getLinkedPort(start, port);
+        if(next == invalidNodeId || nextEntry == noPort) {
+            continue;
+        }
+        relax(next * NodeGraph::maxPorts + nextEntry, weight(next), noLabel, 0, allRows);
+    }
+
+    while(!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<>{});
+        const auto [dist, key] = heap.back();
+        heap.pop_back();
+
+        if(labels[key].settled || labels[key].dist != dist) {
+            continue;
+        }
+        settle(key);
+        const auto node = static_cast<NodeId>(key / NodeGraph::maxPorts);
+        const auto entry = key % NodeGraph::maxPorts;
+
+        if(node == target) {
+            return buildRoute(start, key);
+        }
+
+        const auto kind = graph.getKind(node);
+        const auto &choices = routeChoices[static_cast<std::size_t>(kind)][entry];
+
+        for(std::size_t i = 0; i < choices.count; ++i) {
+            const auto &choice = choices.items[i];
+            const auto next = graph.getLinkedNode(node, choice.exit);
+            const auto nextEntry = graph.getLinkedPort(node, choice.exit);
+            if(next == invalidNodeId || nextEntry == noPort) {
+                continue;
+            }
+
+            auto rows = choice.rows;
+            if(kind != NodeKind::BLOCK && std::popcount(entries[node]) > 1) {
+                rows = restrictRows(node, key, rows);
+                if(!rows) {
+                    continue;
+                }
+            }
+            relax(next * NodeGraph::maxPorts + nextEntry, dist + weight(next), key, labels[key].depth + 1, rows);
+        }
+    }
+    return std::nullopt;
+}
+
+void RouteFinder::relax(std::uint32_t key, std::uint64_t dist, std::uint32_t pred, std::uint32_t depth, std::uint8_t predRows) {
+    auto &label = labels[key];
+    if(label.stamp == generation && (label.settled || label.dist <= dist)) {
+        return;
+    }
+    label = {dist, pred, generation, depth, noLabel, predRows, false};
+
+    const auto node = key / NodeGraph::maxPorts;
+    if(entriesStamp[node] != generation) {
+        entriesStamp[node] = generation;
+        entries[node] = 0;
+    }
+    entries[node] |= 1 << (key % NodeGraph::maxPorts);
+
+    heap.emplace_back(dist, key);
+    std::push_heap(heap.begin(), heap.end(), std::greater<>{});
+}
+
+void RouteFinder::settle(std::uint32_t key) {
+    auto &label = labels[key];
+    label.settled = true;
+
+    // Sprungzeiger nach Myers: alle Vorgänger stehen bereits fest, damit ist jeder
+    // Vorgänger in O(log n) Schritten erreichbar
+    if(label.pred == noLabel) {
+        label.jump = key;
+        return;
+    }
+    const auto &pred = labels[label.pred];
+    const auto &predJump = labels[pred.jump];
+    if(pred.depth - predJump.depth == predJump.depth - labels[predJump.jump].depth) {
+        label.jump = predJump.jump;
+    } else {
+        label.jump = label.pred;
+    }
+}
+
+std::uint32_t RouteFinder::getAncestor(std::uint32_t key, std::uint32_t depth) const {
+    while(labels[key].depth > depth) {
+        const auto &label = labels[key];
+        key = labels[label.jump].depth >= depth ? label.jump : label.pred;
+    }
+    return key;
+}
+
+std::uint8_t RouteFinder::restrictRows(NodeId node, std::uint32_t key, std::uint8_t rows) const {
+    const auto depth = labels[key].depth;
+
+    for(std::uint32_t other = node * NodeGraph::maxPorts; rows && other < (node + 1) * NodeGraph::maxPorts; ++other) {
+        const auto &label = labels[other];
+        if(other == key || label.stamp != generation || !label.settled || label.depth >= depth) {
+            continue;
+        }
+        // liegt other auf dem Weg zu key, steht die Stellung der Durchfahrt in seinem Nachfolger
+        const auto child = getAncestor(key, label.depth + 1);
+        if(labels[child].pred == other) {
+            rows &= labels[child].predRows;
+        }
+    }
+    return rows;
+}
+
+Route RouteFinder::buildRoute(NodeId start, std::uint32_t key) const {
+    Route route;
+    route.weight = labels[key].dist;
+
+    // passRows[i]: Stellungen, mit denen nodes[i] wie gefunden durchfahren wird; sie stehen
+    // jeweils im Label des Nachfolgers
+    std::vector<std::uint8_t> passRows;
+    std::uint8_t rows = allRows;
+    for(auto cur = key; cur != noLabel; cur = labels[cur].pred) {
+        route.nodes.push_back(cur / NodeGraph::maxPorts);
+        passRows.push_back(rows);
+        rows = labels[cur].predRows;
+    }
+    route.nodes.push_back(start);
+    passRows.push_back(allRows);
+
+    std::reverse(route.nodes.begin(), route.nodes.end());
+    std::reverse(passRows.begin(), passRows.end());
+
+    // alle Durchfahrten einer Weiche müssen mit einer Stellung möglich sein
+    std::unordered_map<NodeId, std::uint8_t> allowed;
+    for(std::size_t i = 0; i < route.nodes.size(); ++i) {
+        if(graph.getKind(route.nodes[i]) == NodeKind::BLOCK) {
+            continue;
+        }
+        auto [iter, inserted] = allowed.try_emplace(route.nodes[i], allRows);
+        iter->second &= passRows[i];
+    }
+
+    // Bitmengen für Verschlussprüfungen (siehe Interlocking): Blöcke exklusiv, Weichen
+    // allein über ihre Stellung
+    std::vector<std::uint64_t> nodeBits;
+    std::vector<std::uint64_t> standBits;
+
+    for(const auto node: route.nodes) {
+        if(graph.getKind(node) == NodeKind::BLOCK) {
+            route.blocks.push_back(graph.getId(node));
+            nodeBits.push_back(node);
+            continue;
+        }
+        auto iter = allowed.find(node);
+        if(iter->second == 0) {
+            // bereits ausgegeben
+            continue;
+        }
+        const auto row = std::countr_zero(iter->second);
+        route.switches.push_back({graph.getId(node), getRowState(row)});
+        standBits.push_back(std::uint64_t{node} * stateCount + row);
+        iter->second = 0;
+    }
+    route.nodeBits = getBitWords(nodeBits);
+    route.standBits = getBitWords(standBits);
+    return route;
+}
+
+std::vector<BitWord> RouteFinder::getBitWords(std::vector<std::uint64_t> &bits) {
+    std::sort(bits.begin(), bits.end());
+
+    std::vector<BitWord> words;
+    for(const auto bit: bits) {
+        const auto index = static_cast<std::uint32_t>(bit / 64);
+        if(words.empty() || words.back().index != index) {
+            words.push_back({index, 0});
+        }
+        words.back().bits |= std::uint64_t{1} << (bit % 64);
+    }
+    return words;
+}
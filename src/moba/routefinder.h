@@ -0,0 +1,186 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <moba-common/enumswitchstand.h>
+
+#include "nodegraph.h"
+#include "nodekinds.h"
+
+class RouteFinderException: public std::exception {
+
+    std::string what_;
+
+public:
+    explicit RouteFinderException(const std::string &err) noexcept: what_{err} {
+    }
+
+    RouteFinderException() noexcept: what_{"Unknown error"} {
+    }
+
+    virtual ~RouteFinderException() noexcept = default;
+
+    virtual const char *what() const noexcept {
+        return this->what_.c_str();
+    }
+};
+
+/**
+ * Erforderliche Stellung der Weiche mit der (externen) Id id
+ */
+struct SwitchSetting {
+    unsigned int      id;
+    moba::SwitchStand stand;
+};
+
+/**
+ * Wort einer dünn besetzten Bitmenge: Bits index * 64 bis index * 64 + 63
+ */
+struct BitWord {
+    std::uint32_t index;
+    std::uint64_t bits;
+
+    friend bool operator==(const BitWord&, const BitWord&) = default;
+};
+
+/**
+ * Fahrstraße von einem Block zu einem anderen
+ */
+struct Route {
+    // alle durchfahrenen Knoten in Fahrtrichtung, inklusive Start und Ziel
+    std::vector<NodeId> nodes;
+
+    // Ids der durchfahrenen Blöcke in Fahrtrichtung
+    std::vector<unsigned int> blocks;
+
+    // zu stellende Weichen, in der Reihenfolge der ersten Durchfahrt
+    std::vector<SwitchSetting> switches;
+
+    // Summe der Gewichte aller Knoten nach dem Start
+    std::uint64_t weight = 0;
+
+    // belegte Blöcke, Bit NodeId; nur Worte mit gesetzten Bits, aufsteigend sortiert
+    std::vector<BitWord> nodeBits;
+
+    // geforderte Weichenstellungen, Bit NodeId * 4 + getStateRow(stand); Weichen sind
+    // nur hier enthalten, nicht in nodeBits
+    std::vector<BitWord> standBits;
+};
+
+/**
+ * Fahrstraßensuche auf einem NodeGraph. Die Stellungen der Weichen sind frei wählbar:
+ * Gesucht wird per Dijkstra über die Zustände (Knoten, Einfahrtsanschluss), die möglichen
+ * Ausgänge einer Weiche ergeben sich aus ihrer Übergangstabelle über alle Stellungen.
+ * Die aktuelle Stellung der Weichen wird weder gelesen noch verändert.
+ *
+ * Wird eine Weiche mehrfach durchfahren (z.B. Kehrschleife), muss es eine Stellung geben,
+ * die alle Durchfahrten erlaubt, andernfalls wird der Weg verworfen. Da je Zustand nur
+ * der kürzeste Weg behalten wird, kann in diesem Sonderfall eine längere zulässige
+ * Fahrstraße unentdeckt bleiben.
+ *
+ * Die Puffer der Suche werden zwischen Aufrufen wiederverwendet, ein RouteFinder darf
+ * daher nicht gleichzeitig aus mehreren Threads benutzt werden. Er ist nur so lange
+ * gültig wie der Graph.
+ */
+class RouteFinder {
+public:
+    explicit RouteFinder(const NodeGraph &graph): graph{graph} {
+    }
+
+    /**
+     * Kürzeste Fahrstraße nach Anzahl der durchfahrenen Knoten
+     *
+     * @param from Id des Startblocks
+     * @param to Id des Zielblocks
+     * @param exit Ausfahrt aus dem Startblock (0 in, 1 out), std::nullopt für beide
+     */
+    [[nodiscard]] std::optional<Route> findRoute(
+        unsigned int from, unsigned int to, std::optional<NodeGraph::Port> exit = std::nullopt
+    );
+
+    /**
+     * Wie oben, gewichtet: weights enthält je NodeId die Kosten für das Befahren des
+     * Knotens (z.B. Blocklänge)
+     */
+    [[nodiscard]] std::optional<Route> findRoute(
+        unsigned int from, unsigned int to, std::optional<NodeGraph::Port> exit,
+        const std::vector<unsigned int> &weights
+    );
+
+protected:
+    static constexpr std::uint32_t noLabel = std::numeric_limits<std::uint32_t>::max();
+
+    /**
+     * Bester bekannter Weg zum Zustand (Knoten, Einfahrtsanschluss)
+     */
+    struct Label {
+        std::uint64_t dist;
+        std::uint32_t pred;     // Vorgängerzustand oder noLabel
+        std::uint32_t stamp;    // gültig, wenn gleich generation
+        std::uint32_t depth;    // Anzahl der Vorgänger
+        std::uint32_t jump;     // weiter entfernter Vorgänger für getAncestor (skew-binär)
+        std::uint8_t  predRows; // zulässige Stellungen (Bitmaske der Tabellenzeilen) im Vorgänger
+        bool          settled;  // kürzester Weg steht fest, pred ändert sich nicht mehr
+    };
+
+    const NodeGraph &graph;
+
+    std::vector<Label>        labels;  // je NodeId * maxPorts + Anschluss
+    std::vector<std::uint8_t> entries; // je NodeId: Anschlüsse mit gültigem Label
+    std::vector<std::uint32_t> entriesStamp;
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> heap;
+
+    std::uint32_t generation = 0;
+
+    void prepare();
+
+    template<typename Weight>
+    std::optional<Route> search(NodeId start, NodeId target, std::optional<NodeGraph::Port> exit, Weight weight);
+
+    void settle(std::uint32_t key);
+
+    /**
+     * Liefert den Vorgänger von key mit der Tiefe depth (key muss feststehen)
+     */
+    [[nodiscard]] std::uint32_t getAncestor(std::uint32_t key, std::uint32_t depth) const;
+
+    /**
+     * Schränkt rows auf die Stellungen ein, die auch alle früheren Durchfahrten von node
+     * auf dem Weg zu key erlauben. Jeder Knoten hat höchstens maxPorts Zustände, je Zustand
+     * genügt eine Vorgängersuche über die Sprungzeiger statt den ganzen Weg abzulaufen.
+     */
+    [[nodiscard]] std::uint8_t restrictRows(NodeId node, std::uint32_t key, std::uint8_t rows) const;
+
+    void relax(std::uint32_t key, std::uint64_t dist, std::uint32_t pred, std::uint32_t depth, std::uint8_t predRows);
+
+    [[nodiscard]] Route buildRoute(NodeId start, std::uint32_t key) const;
+
+    [[nodiscard]] static std::vector<BitWord> getBitWords(std::vector<std::uint64_t> &bits);
+
+    std::pair<NodeId, NodeId> getBlocks(unsigned int from, unsigned int to, std::optional<NodeGraph::Port> exit) const;
+};
@@ -0,0 +1,82 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "container.h"
+#include "storage_tiled.h"
+
+/**
+ * Versionierter Container für gleichzeitige Leser während Änderungen. Leser holen sich
+ * mit getSnapshot() eine unveränderliche Version, die so lange gültig bleibt, wie sie
+ * referenziert wird; sie warten dabei nie auf einen Schreiber. Schreiber erzeugen mit
+ * update() eine neue Version. Mit der Standard-Speicherstrategie TiledStorage werden dabei
+ * nur die Kachel-Tabelle und die tatsächlich geänderten Kacheln kopiert. Alte Versionen
+ * werden freigegeben, sobald ihr letzter Leser sie loslässt.
+ */
+template<typename T, typename Storage = TiledStorage<T>>
+class SnapshotContainer {
+public:
+    using Layout = Container<T, Storage>;
+    using Snapshot = std::shared_ptr<const Layout>;
+
+    SnapshotContainer(): current{std::make_shared<const Layout>()} {
+    }
+
+    explicit SnapshotContainer(Layout layout): current{std::make_shared<const Layout>(std::move(layout))} {
+    }
+
+    SnapshotContainer(const SnapshotContainer&) = delete;
+    SnapshotContainer& operator=(const SnapshotContainer&) = delete;
+
+    virtual ~SnapshotContainer() noexcept = default;
+
+    [[nodiscard]] Snapshot getSnapshot() const {
+        return current.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Wendet edit auf eine Kopie der aktuellen Version an und veröffentlicht diese
+     * anschließend. Schreiber werden untereinander serialisiert. Wirft edit eine
+     * Exception, bleibt die aktuelle Version unverändert.
+     *
+     * @return Snapshot die neu veröffentlichte Version
+     */
+    template<typename F>
+    Snapshot update(F &&edit) {
+        std::lock_guard<std::mutex> lock{writeMutex};
+
+        auto next = std::make_shared<Layout>(*current.load(std::memory_order_relaxed));
+        std::forward<F>(edit)(*next);
+
+        Snapshot snapshot = std::move(next);
+        current.store(snapshot, std::memory_order_release);
+        return snapshot;
+    }
+
+protected:
+    std::atomic<Snapshot> current;
+    std::mutex writeMutex;
+};
@@ -0,0 +1,206 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "position.h"
+
+/**
+ * Speicherstrategie für Container als zeilenweise abgelegtes, dichtes Array. Die
+ * Größe richtet sich nach der größten abgelegten Position, pro Zelle werden sizeof(T)
+ * Bytes plus ein Belegt-Bit benötigt. Zugriffe kosten O(1), eine Zeile liegt
+ * zusammenhängend im Speicher.
+ */
+template<typename T>
+class DenseStorage {
+public:
+    bool addItem(const Position &pos, T item) {
+        if(pos.x >= width || pos.y >= height) {
+            resize(
+                pos.x < width ? width : std::max(pos.x + 1, width * 2),
+                pos.y < height ? height : std::max(pos.y + 1, height * 2)
+            );
+        }
+        const auto idx = pos.y * width + pos.x;
+        cells[idx] = std::move(item);
+
+        const auto mask = std::uint64_t{1} << (idx % 64);
+        if(occupied[idx / 64] & mask) {
+            return false;
+        }
+        occupied[idx / 64] |= mask;
+        ++count;
+        return true;
+    }
+
+    bool removeItem(const Position &pos) {
+        const auto idx = getIndex(pos);
+        if(idx == npos) {
+            return false;
+        }
+        cells[idx] = T{};
+        occupied[idx / 64] &= ~(std::uint64_t{1} << (idx % 64));
+        --count;
+        return true;
+    }
+
+    T *find(const Position &pos) {
+        const auto idx = getIndex(pos);
+        return idx == npos ? nullptr : &cells[idx];
+    }
+
+    const T *find(const Position &pos) const {
+        const auto idx = getIndex(pos);
+        return idx == npos ? nullptr : &cells[idx];
+    }
+
+    [[nodiscard]] std::size_t itemsCount() const {
+        return count;
+    }
+
+    [[nodiscard]] std::optional<Position> getFirstPosition() const {
+        for(std::size_t w = 0; w < occupied.size(); ++w) {
+            if(occupied[w]) {
+                const auto idx = w * 64 + std::countr_zero(occupied[w]);
+                return Position{idx % width, idx / width};
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::uint8_t getNeighbours(const Position &pos, std::uint8_t directions, std::array<T, 8> &neighbours) const {
+        std::uint8_t found = 0;
+        for(auto bits = directions; bits; bits &= bits - 1) {
+            const auto dir = static_cast<Direction::Position>(bits & -bits);
+            const auto next = pos.step(dir);
+            if(!next) {
+                continue;
+            }
+            const auto idx = getIndex(*next);
+            if(idx != npos) {
+                neighbours[std::countr_zero(bits)] = cells[idx];
+                found |= dir;
+            }
+        }
+        return found;
+    }
+
+    /**
+     * Sucht ab pos (einschließlich) zeilenweise die nächste belegte Zelle innerhalb des
+     * Rechtecks from / to. Jede Zeile wird wortweise über die Belegt-Bits abgesucht.
+     */
+    const T *findNext(Position &pos, const Position &from, const Position &to) const {
+        if(!width || to.x < from.x) {
+            return nullptr;
+        }
+        const auto lastX = std::min(to.x, width - 1);
+        const auto lastY = std::min(to.y, height - 1);
+
+        for(; pos.y <= lastY; pos = {from.x, pos.y + 1}) {
+            if(pos.x > lastX) {
+                continue;
+            }
+            const auto idx = findSetBit(pos.y * width + pos.x, pos.y * width + lastX);
+            if(idx != npos) {
+                pos.x = idx - pos.y * width;
+                return &cells[idx];
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Reserviert Speicher für alle Positionen bis einschließlich maxPos
+     */
+    void reserve(std::size_t, const Position &maxPos) {
+        if(maxPos.x >= width || maxPos.y >= height) {
+            resize(std::max(maxPos.x + 1, width), std::max(maxPos.y + 1, height));
+        }
+    }
+
+protected:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    std::size_t getIndex(const Position &pos) const {
+        if(pos.x >= width || pos.y >= height) {
+            return npos;
+        }
+        const auto idx = pos.y * width + pos.x;
+        if(!(occupied[idx / 64] >> (idx % 64) & 1)) {
+            return npos;
+        }
+        return idx;
+    }
+
+    /**
+     * Liefert den Index des ersten gesetzten Belegt-Bits im Bereich first bis last
+     * (jeweils einschließlich) oder npos
+     */
+    std::size_t findSetBit(std::size_t first, std::size_t last) const {
+        for(auto w = first / 64; w <= last / 64; ++w) {
+            auto bits = occupied[w];
+            if(w == first / 64) {
+                bits &= ~std::uint64_t{0} << (first % 64);
+            }
+            if(w == last / 64) {
+                bits &= ~std::uint64_t{0} >> (63 - last % 64);
+            }
+            if(bits) {
+                return w * 64 + std::countr_zero(bits);
+            }
+        }
+        return npos;
+    }
+
+    /**
+     * Vergrößert das Raster auf newWidth x newHeight. Beim Einfügen wachsen Breite und
+     * Höhe mindestens um den Faktor 2, damit zeilenweises Befüllen amortisiert O(1) bleibt.
+     */
+    void resize(std::size_t newWidth, std::size_t newHeight) {
+        std::vector<T> newCells(newWidth * newHeight);
+        std::vector<std::uint64_t> newOccupied((newWidth * newHeight + 63) / 64);
+
+        for(std::size_t w = 0; w < occupied.size(); ++w) {
+            for(auto bits = occupied[w]; bits; bits &= bits - 1) {
+                const auto idx = w * 64 + std::countr_zero(bits);
+                const auto newIdx = idx / width * newWidth + idx % width;
+                newCells[newIdx] = std::move(cells[idx]);
+                newOccupied[newIdx / 64] |= std::uint64_t{1} << (newIdx % 64);
+            }
+        }
+        cells = std::move(newCells);
+        occupied = std::move(newOccupied);
+        width = newWidth;
+        height = newHeight;
+    }
+
+    std::vector<T> cells;
+    std::vector<std::uint64_t> occupied;
+    std::size_t width = 0;
+    std::size_t height = 0;
+    std::size_t count = 0;
+};
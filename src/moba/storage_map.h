@@ -0,0 +1,184 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <map>
+#include <optional>
+
+#include "packedposition.h"
+#include "position.h"
+
+/**
+ * Speicherstrategie für Container auf Basis von std::map. Geeignet für beliebig dünn
+ * besetzte Gleispläne, jeder Zugriff kostet allerdings O(log n). Als Schlüssel dient
+ * der 64-Bit-Schlüssel von PackedPosition (zeilenweise sortiert), Koordinaten sind
+ * daher auf 31 Bit beschränkt.
+ */
+template<typename T>
+class MapStorage {
+public:
+    /**
+     * Legt ein Element ab bzw. ersetzt ein vorhandenes
+     *
+     * @return bool true -> Element wurde neu angelegt, false -> Element wurde ersetzt
+     * @throws std::out_of_range wenn pos nicht in 31 Bit passt
+     */
+    bool addItem(const Position &pos, T item) {
+        const auto key = PackedPosition{pos}.getKey();
+
+        // Sortiert angelieferte Zellen werden direkt am Ende eingehängt (amortisiert O(1))
+        if(items.empty() || items.rbegin()->first < key) {
+            items.emplace_hint(items.end(), key, std::move(item));
+            return true;
+        }
+        auto [iter, inserted] = items.insert_or_assign(key, std::move(item));
+        return inserted;
+    }
+
+    void reserve(std::size_t, const Position&) {
+    }
+
+    bool removeItem(const Position &pos) {
+        return PackedPosition::fits(pos) && items.erase(PackedPosition{pos}.getKey()) != 0;
+    }
+
+    T *find(const Position &pos) {
+        if(!PackedPosition::fits(pos)) {
+            return nullptr;
+        }
+        auto iter = items.find(PackedPosition{pos}.getKey());
+        return iter == items.end() ? nullptr : &iter->second;
+    }
+
+    const T *find(const Position &pos) const {
+        if(!PackedPosition::fits(pos)) {
+            return nullptr;
+        }
+        auto iter = items.find(PackedPosition{pos}.getKey());
+        return iter == items.end() ? nullptr : &iter->second;
+    }
+
+    [[nodiscard]] std::size_t itemsCount() const {
+        return items.size();
+    }
+
+    /**
+     * Liefert die erste belegte Position (zeilenweise sortiert)
+     */
+    [[nodiscard]] std::optional<Position> getFirstPosition() const {
+        if(items.empty()) {
+            return std::nullopt;
+        }
+        return getPosition(items.begin()->first);
+    }
+
+    /**
+     * Sucht ab pos (einschließlich) zeilenweise die nächste belegte Zelle innerhalb des
+     * Rechtecks from / to (jeweils einschließlich). Pro belegter Zeile wird ein
+     * lower_bound benötigt, leere Zeilen werden übersprungen.
+     *
+     * @return const T* gefundenes Element (pos wird auf dessen Position gesetzt) oder nullptr
+     */
+    const T *findNext(Position &pos, const Position &from, const Position &to) const {
+        if(to.x < from.x || !PackedPosition::fits(from)) {
+            return nullptr;
+        }
+        while(pos.y <= to.y && PackedPosition::fits({from.x, pos.y})) {
+            if(!PackedPosition::fits(pos)) {
+                pos = {from.x, pos.y + 1};
+                continue;
+            }
+            auto iter = items.lower_bound(PackedPosition{pos}.getKey());
+            if(iter == items.end()) {
+                return nullptr;
+            }
+            const auto found = getPosition(iter->first);
+            if(found.y > to.y) {
+                return nullptr;
+            }
+            if(found.y != pos.y) {
+                pos = {from.x, found.y};
+                if(found.x < from.x) {
+                    continue;
+                }
+            }
+            if(found.x <= to.x) {
+                pos = found;
+                return &iter->second;
+            }
+            pos = {from.x, pos.y + 1};
+        }
+        return nullptr;
+    }
+
+    /**
+     * Sucht die in directions gesetzten Nachbarn von pos. Statt acht Einzelsuchen wird
+     * pro betroffener Zeile nur ein lower_bound benötigt.
+     *
+     * @return std::uint8_t Bitmaske der gefundenen Nachbarn
+     */
+    std::uint8_t getNeighbours(const Position &pos, std::uint8_t directions, std::array<T, 8> &neighbours) const {
+        static constexpr std::uint8_t rows[3][3] = {
+            {Direction::TOP_LEFT,    Direction::TOP,    Direction::TOP_RIGHT},
+            {Direction::LEFT,        Direction::UNSET,  Direction::RIGHT},
+            {Direction::BOTTOM_LEFT, Direction::BOTTOM, Direction::BOTTOM_RIGHT}
+        };
+
+        if(!PackedPosition::fits(pos)) {
+            return 0;
+        }
+
+        std::uint8_t found = 0;
+        for(std::size_t r = 0; r < 3; ++r) {
+            if(!(directions & (rows[r][0] | rows[r][1] | rows[r][2])) || (r == 0 && pos.y == 0)) {
+                continue;
+            }
+            const auto y = pos.y + r - 1;
+            auto iter = items.lower_bound(PackedPosition{
+                static_cast<std::int32_t>(pos.x ? pos.x - 1 : 0), static_cast<std::int32_t>(y)
+            }.getKey());
+
+            for(; iter != items.end(); ++iter) {
+                const auto next = getPosition(iter->first);
+                if(next.y != y || next.x > pos.x + 1) {
+                    break;
+                }
+                const auto dir = rows[r][next.x + 1 - pos.x];
+                if(directions & dir) {
+                    neighbours[std::countr_zero(dir)] = iter->second;
+                    found |= dir;
+                }
+            }
+        }
+        return found;
+    }
+
+protected:
+    static Position getPosition(std::uint64_t key) {
+        const auto pos = PackedPosition::fromKey(key);
+        return {static_cast<std::size_t>(pos.x), static_cast<std::size_t>(pos.y)};
+    }
+
+    std::map<std::uint64_t, T> items;
+};
@@ -0,0 +1,179 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+
+#include "morton.h"
+#include "position.h"
+
+/**
+ * Speicherstrategie für Container, deren Schlüssel der 64-Bit-Morton-Code der Position
+ * ist. Anders als bei der zeilenweisen Sortierung von Position liegen so auch
+ * übereinander liegende Zellen im Baum nahe beieinander, Nachbarschlüssel werden
+ * direkt aus dem Code berechnet. Koordinaten sind auf 32 Bit beschränkt.
+ */
+template<typename T>
+class MortonStorage {
+public:
+    bool addItem(const Position &pos, T item) {
+        auto [iter, inserted] = items.insert_or_assign(getKey(pos), std::move(item));
+        return inserted;
+    }
+
+    bool removeItem(const Position &pos) {
+        return isInRange(pos) && items.erase(getKey(pos)) != 0;
+    }
+
+    void reserve(std::size_t, const Position&) {
+    }
+
+    T *find(const Position &pos) {
+        if(!isInRange(pos)) {
+            return nullptr;
+        }
+        auto iter = items.find(getKey(pos));
+        return iter == items.end() ? nullptr : &iter->second;
+    }
+
+    const T *find(const Position &pos) const {
+        if(!isInRange(pos)) {
+            return nullptr;
+        }
+        auto iter = items.find(getKey(pos));
+        return iter == items.end() ? nullptr : &iter->second;
+    }
+
+    [[nodiscard]] std::size_t itemsCount() const {
+        return items.size();
+    }
+
+    /**
+     * Liefert die erste belegte Position (zeilenweise sortiert). Die oberste belegte Zeile
+     * wird per Intervallhalbierung über Rechtecke [0, y] gesucht, statt alle Zellen zu
+     * durchlaufen.
+     */
+    [[nodiscard]] std::optional<Position> getFirstPosition() const {
+        if(items.empty()) {
+            return std::nullopt;
+        }
+        std::uint32_t top = 0;
+        std::uint32_t bottom = Morton::decodeY(items.begin()->first);
+
+        while(top < bottom) {
+            const auto mid = top + (bottom - top) / 2;
+            if(hasItemAbove(mid)) {
+                bottom = mid;
+            } else {
+                top = mid + 1;
+            }
+        }
+        Position pos{0, top};
+        findNext(pos, pos, {std::numeric_limits<std::uint32_t>::max(), top});
+        return pos;
+    }
+
+    std::uint8_t getNeighbours(const Position &pos, std::uint8_t directions, std::array<T, 8> &neighbours) const {
+        if(!isInRange(pos)) {
+            return 0;
+        }
+        const auto key = getKey(pos);
+
+        std::uint8_t found = 0;
+        for(auto bits = directions; bits; bits &= bits - 1) {
+            const auto dir = static_cast<Direction::Position>(bits & -bits);
+            // am Rand des Koordinatenbereichs würde der Code überlaufen
+            if(const auto next = pos.step(dir); !next || !isInRange(*next)) {
+                continue;
+            }
+            auto iter = items.find(Morton::step(key, dir));
+            if(iter != items.end()) {
+                neighbours[std::countr_zero(bits)] = iter->second;
+                found |= dir;
+            }
+        }
+        return found;
+    }
+
+    /**
+     * Sucht ab pos zeilenweise die nächste belegte Zelle innerhalb des Rechtecks from / to.
+     * Schlüssel außerhalb der aktuellen Zeile werden per BIGMIN übersprungen.
+     */
+    const T *findNext(Position &pos, const Position &from, const Position &to) const {
+        constexpr std::size_t limit = std::numeric_limits<std::uint32_t>::max();
+
+        const auto lastX = std::min(to.x, limit);
+        const auto lastY = std::min(to.y, limit);
+
+        for(; pos.y <= lastY && from.x <= lastX; pos = {from.x, pos.y + 1}) {
+            if(pos.x > lastX) {
+                continue;
+            }
+            const auto min = Morton::encode(static_cast<std::uint32_t>(pos.x), static_cast<std::uint32_t>(pos.y));
+            const auto max = Morton::encode(static_cast<std::uint32_t>(lastX), static_cast<std::uint32_t>(pos.y));
+
+            for(auto iter = items.lower_bound(min); iter != items.end() && iter->first <= max;) {
+                if(Morton::decodeY(iter->first) == pos.y && Morton::decodeX(iter->first) <= lastX) {
+                    pos.x = Morton::decodeX(iter->first);
+                    return &iter->second;
+                }
+                iter = items.lower_bound(Morton::getNextInRange(iter->first, min, max));
+            }
+        }
+        return nullptr;
+    }
+
+protected:
+    static bool isInRange(const Position &pos) {
+        return pos.x <= std::numeric_limits<std::uint32_t>::max() && pos.y <= std::numeric_limits<std::uint32_t>::max();
+    }
+
+    static std::uint64_t getKey(const Position &pos) {
+        if(!isInRange(pos)) {
+            throw std::out_of_range{"position exceeds 32 bit"};
+        }
+        return Morton::encode(static_cast<std::uint32_t>(pos.x), static_cast<std::uint32_t>(pos.y));
+    }
+
+    /**
+     * Prüft, ob eine Zelle in den Zeilen 0 bis y belegt ist
+     */
+    bool hasItemAbove(std::uint32_t y) const {
+        const auto min = Morton::encode(0, 0);
+        const auto max = Morton::encode(std::numeric_limits<std::uint32_t>::max(), y);
+
+        for(auto iter = items.lower_bound(min); iter != items.end() && iter->first <= max;) {
+            if(Morton::decodeY(iter->first) <= y) {
+                return true;
+            }
+            iter = items.lower_bound(Morton::getNextInRange(iter->first, min, max));
+        }
+        return false;
+    }
+
+    std::map<std::uint64_t, T> items;
+};
@@ -0,0 +1,326 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include "position.h"
+
+/**
+ * Speicherstrategie für Container in Form von Kacheln fester Größe (TileBits = 4 ->
+ * 16x16 Zellen), die in einer Hash-Map über ihre Kachelkoordinate abgelegt werden.
+ * Leere Bereiche des Gleisplans belegen so keinen Speicher, Zugriffe kosten
+ * trotzdem nur einen Hash-Lookup plus einen Array-Zugriff. Die Kachelkoordinaten sind
+ * auf 32 Bit beschränkt, Positionen ab 2^(32 + TileBits) werden abgewiesen.
+ *
+ * Kopien teilen sich die Kacheln (Copy-on-Write): Jede Instanz hat eine Generation, jede
+ * Kachel die Generation der Instanz, die sie angelegt hat. Beim Kopieren erhalten Quelle
+ * und Kopie eine neue Generation, alle bis dahin vorhandenen Kacheln gelten damit für
+ * beide als unveränderlich und werden beim ersten Ändern dupliziert. Eine veröffentlichte
+ * Kachel wird so nie an Ort und Stelle geändert, auch nicht, wenn ein Leser in einem
+ * anderen Thread seine Kopie gerade freigibt (use_count() wäre dafür nicht verlässlich).
+ */
+template<typename T, unsigned int TileBits = 4>
+class TiledStorage {
+public:
+    static constexpr std::size_t TILE_SIZE = std::size_t{1} << TileBits;
+
+    struct Tile {
+        std::uint64_t key;
+        std::uint64_t generation;
+        std::array<T, TILE_SIZE * TILE_SIZE> cells;
+        std::array<std::uint64_t, (TILE_SIZE * TILE_SIZE + 63) / 64> occupied{};
+
+        static std::size_t getIndex(const Position &pos) {
+            return (pos.y & (TILE_SIZE - 1)) * TILE_SIZE + (pos.x & (TILE_SIZE - 1));
+        }
+
+        [[nodiscard]] bool contains(const Position &pos) const {
+            return key == getKey(pos);
+        }
+
+        [[nodiscard]] bool isSet(std::size_t idx) const {
+            return occupied[idx / 64] >> (idx % 64) & 1;
+        }
+
+        const T *find(const Position &pos) const {
+            const auto idx = getIndex(pos);
+            return isSet(idx) ? &cells[idx] : nullptr;
+        }
+    };
+
+    TiledStorage() = default;
+
+    /**
+     * Die Quelle erhält ebenfalls eine neue Generation; das ist der einzige Schreibzugriff
+     * auf sie und betrifft keine Daten, die Leser verwenden
+     */
+    TiledStorage(const TiledStorage &other):
+    tiles{other.tiles}, count{other.count}, generation{nextGeneration()} {
+        other.generation.store(nextGeneration(), std::memory_order_relaxed);
+    }
+
+    TiledStorage(TiledStorage &&other) noexcept:
+    tiles{std::move(other.tiles)}, count{other.count}, generation{other.generation.load(std::memory_order_relaxed)} {
+        other.count = 0;
+    }
+
+    TiledStorage &operator=(const TiledStorage &other) {
+        if(this != &other) {
+            tiles = other.tiles;
+            count = other.count;
+            generation.store(nextGeneration(), std::memory_order_relaxed);
+            other.generation.store(nextGeneration(), std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    TiledStorage &operator=(TiledStorage &&other) noexcept {
+        tiles = std::move(other.tiles);
+        count = other.count;
+        generation.store(other.generation.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        other.count = 0;
+        return *this;
+    }
+
+    ~TiledStorage() noexcept = default;
+
+    bool addItem(const Position &pos, T item) {
+        auto &tile = getWritableTile(getKey(pos));
+        const auto idx = Tile::getIndex(pos);
+        tile->cells[idx] = std::move(item);
+
+        if(tile->isSet(idx)) {
+            return false;
+        }
+        tile->occupied[idx / 64] |= std::uint64_t{1} << (idx % 64);
+        ++count;
+        return true;
+    }
+
+    /**
+     * Dimensioniert die Hash-Map vorab für count Zellen. Angenommen wird, dass jede
+     * Kachel im Schnitt mindestens eine volle Zeile belegt.
+     */
+    void reserve(std::size_t count, const Position&) {
+        tiles.reserve(count / TILE_SIZE + 1);
+    }
+
+    /**
+     * Entfernt die Zelle an pos; leer gewordene Kacheln werden freigegeben
+     */
+    bool removeItem(const Position &pos) {
+        if(!isInRange(pos)) {
+            return false;
+        }
+        auto iter = tiles.find(getKey(pos));
+        if(iter == tiles.end() || !iter->second->find(pos)) {
+            return false;
+        }
+        auto &tile = getWritableTile(iter->first);
+        const auto idx = Tile::getIndex(pos);
+        tile->cells[idx] = T{};
+        tile->occupied[idx / 64] &= ~(std::uint64_t{1} << (idx % 64));
+        --count;
+
+        if(std::all_of(tile->occupied.begin(), tile->occupied.end(), [](auto bits) {return !bits;})) {
+            tiles.erase(iter);
+        }
+        return true;
+    }
+
+    T *find(const Position &pos) {
+        if(!isInRange(pos)) {
+            return nullptr;
+        }
+        auto iter = tiles.find(getKey(pos));
+        if(iter == tiles.end() || !iter->second->find(pos)) {
+            return nullptr;
+        }
+        return &getWritableTile(iter->first)->cells[Tile::getIndex(pos)];
+    }
+
+    const T *find(const Position &pos) const {
+        auto tile = getTile(pos);
+        return tile ? tile->find(pos) : nullptr;
+    }
+
+    /**
+     * Wie find, verwendet aber die Kachel aus hint weiter, solange pos darin liegt.
+     * Zugriffe auf benachbarte Zellen (z.B. beim Verfolgen eines Gleises) kommen so
+     * meist ohne Hash-Lookup aus. hint wird auf die Kachel von pos gesetzt.
+     */
+    const T *find(const Position &pos, const Tile *&hint) const {
+        if(!isInRange(pos)) {
+            return nullptr;
+        }
+        if(!hint || !hint->contains(pos)) {
+            hint = getTile(pos);
+        }
+        return hint ? hint->find(pos) : nullptr;
+    }
+
+    /**
+     * Sucht die in directions gesetzten Nachbarn von pos. Liegt pos nicht am Kachelrand,
+     * genügt ein einziger Hash-Lookup für alle acht Nachbarn.
+     */
+    std::uint8_t getNeighbours(const Position &pos, std::uint8_t directions, std::array<T, 8> &neighbours) const {
+        const Tile *hint = nullptr;
+        std::uint8_t found = 0;
+        for(auto bits = directions; bits; bits &= bits - 1) {
+            const auto dir = static_cast<Direction::Position>(bits & -bits);
+            const auto next = pos.step(dir);
+            if(!next) {
+                continue;
+            }
+            if(auto item = find(*next, hint)) {
+                neighbours[std::countr_zero(bits)] = *item;
+                found |= dir;
+            }
+        }
+        return found;
+    }
+
+    /**
+     * Sucht ab pos (einschließlich) zeilenweise die nächste belegte Zelle innerhalb des
+     * Rechtecks from / to. Nicht vorhandene Kacheln werden in einem Schritt übersprungen.
+     */
+    const T *findNext(Position &pos, const Position &from, const Position &to) const {
+        const auto lastX = std::min(to.x, limit);
+        const auto lastY = std::min(to.y, limit);
+
+        if(lastX < from.x) {
+            return nullptr;
+        }
+        for(; pos.y <= lastY; pos = {from.x, pos.y + 1}) {
+            while(pos.x <= lastX) {
+                const auto tileEnd = (pos.x | (TILE_SIZE - 1));
+                const auto last = std::min(tileEnd, lastX);
+
+                if(auto tile = getTile(pos)) {
+                    for(; pos.x <= last; ++pos.x) {
+                        if(auto item = tile->find(pos)) {
+                            return item;
+                        }
+                    }
+                }
+                if(tileEnd >= lastX) {
+                    break;
+                }
+                pos.x = tileEnd + 1;
+            }
+        }
+        return nullptr;
+    }
+
+    const Tile *getTile(const Position &pos) const {
+        if(!isInRange(pos)) {
+            return nullptr;
+        }
+        auto iter = tiles.find(getKey(pos));
+        return iter == tiles.end() ? nullptr : iter->second.get();
+    }
+
+    [[nodiscard]] std::size_t itemsCount() const {
+        return count;
+    }
+
+    [[nodiscard]] std::size_t tilesCount() const {
+        return tiles.size();
+    }
+
+    [[nodiscard]] std::optional<Position> getFirstPosition() const {
+        std::optional<Position> first;
+
+        for(const auto &[key, tile]: tiles) {
+            for(std::size_t w = 0; w < tile->occupied.size(); ++w) {
+                if(!tile->occupied[w]) {
+                    continue;
+                }
+                const auto idx = w * 64 + std::countr_zero(tile->occupied[w]);
+                const Position pos{
+                    (key & 0xFFFFFFFF) * TILE_SIZE + idx % TILE_SIZE,
+                    (key >> 32) * TILE_SIZE + idx / TILE_SIZE
+                };
+                if(!first || pos < *first) {
+                    first = pos;
+                }
+                break;
+            }
+        }
+        return first;
+    }
+
+protected:
+    // größte Koordinate, deren Kachelkoordinate noch in 32 Bit passt
+    static constexpr std::size_t limit =
+        (std::size_t{std::numeric_limits<std::uint32_t>::max()} << TileBits) | (TILE_SIZE - 1);
+
+    static bool isInRange(const Position &pos) {
+        return pos.x <= limit && pos.y <= limit;
+    }
+
+    static std::uint64_t getKey(const Position &pos) {
+        if(!isInRange(pos)) {
+            throw std::out_of_range{"position exceeds tile range"};
+        }
+        return static_cast<std::uint64_t>(pos.y >> TileBits) << 32 | static_cast<std::uint32_t>(pos.x >> TileBits);
+    }
+
+    static std::uint64_t nextGeneration() noexcept {
+        static std::atomic<std::uint64_t> last{0};
+        return last.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    /**
+     * Liefert die Kachel key zum Ändern. Eine Kachel aus einer früheren Generation kann
+     * mit einer Kopie geteilt sein und wird vorher dupliziert.
+     */
+    std::shared_ptr<Tile> &getWritableTile(std::uint64_t key) {
+        const auto current = generation.load(std::memory_order_relaxed);
+        auto &tile = tiles[key];
+        if(!tile) {
+            tile = std::make_shared<Tile>();
+            tile->key = key;
+            tile->generation = current;
+        } else if(tile->generation != current) {
+            tile = std::make_shared<Tile>(*tile);
+            tile->generation = current;
+        }
+        return tile;
+    }
+
+    std::unordered_map<std::uint64_t, std::shared_ptr<Tile>> tiles;
+    std::size_t count = 0;
+
+    // mutable, da auch das Kopieren aus einer const-Quelle dieser eine neue Generation gibt
+    mutable std::atomic<std::uint64_t> generation{nextGeneration()};
+};
@@ -20,15 +20,6 @@
 
 #include "symbol.h"
 
-Symbol::Symbol(std::uint8_t symbol): symbolFix{symbol}, symbolDyn{symbol} {
-    if(isSymbol() && !isValidSymbol()) {
-        throw std::invalid_argument("invalid symbol given");
-    }
-}
-
-Symbol::Symbol(Symbol::SymbolType symbol): symbolFix{static_cast<std::uint8_t>(symbol)}, symbolDyn{static_cast<std::uint8_t>(symbol)} {
-}
-
 Symbol::operator bool() const {
     return isSymbol();
 }
@@ -46,6 +37,17 @@ void Symbol::rotateRight(unsigned int count) {
 }
 
 std::uint8_t Symbol::getDistance(Symbol symbol) const {
+    const auto &info = symbolTable[symbolFix];
+    const auto &other = symbolTable[symbol.symbolFix];
+
+    if(info.type && info.type == other.type) {
+        return (info.distance + info.period - other.distance) % info.period;
+    }
+
+    if(info.type || other.type) {
+        throw std::invalid_argument{"given symbol does not match"};
+    }
+
     for(std::uint8_t i = 0; i < 8; ++i) {
         if(symbolFix == symbol.symbolFix) {
             return i;
@@ -55,13 +57,6 @@ std::uint8_t Symbol::getDistance(Symbol symbol) const {
     throw std::invalid_argument{"given symbol does not match"};
 }
 
-bool Symbol::isSymbol() const {
-    if(symbolFix != 0) {
-        return true;
-    }
-    return false;
-}
-
 bool Symbol::isStartSymbol() const {
     if(symbolFix & Direction::LEFT) {
         return false;
@@ -92,95 +87,6 @@ bool Symbol::check(const Symbol &symbol) const {
     return check(8, symbol.symbolFix);
 }
 
-bool Symbol::isEnd() const {
-    return check(8, SymbolType::END);
-}
-
-bool Symbol::isStraight() const {
-    return check(4, SymbolType::STRAIGHT);
-}
-
-bool Symbol::isCrossOver() const {
-    return check(2, SymbolType::CROSS_OVER);
-}
-
-bool Symbol::isBend() const {
-    return check(8, SymbolType::BEND);
-}
-
-bool Symbol::isTrack() const {
-    if(isStraight()) {
-        return true;
-    }
-    if(isCrossOver()) {
-        return true;
-    }
-    if(isBend()) {
-        return true;
-    }
-    if(isEnd()) {
-        return true;
-    }
-    return false;
-}
-
-bool Symbol::isCrossOverSwitch() const {
-    return check(4, SymbolType::CROSS_OVER_SWITCH);
-}
-
-bool Symbol::isLeftSwitch() const {
-    return check(8, SymbolType::LEFT_SWITCH);
-}
-
-bool Symbol::isRightSwitch() const {
-    return check(8, SymbolType::RIGHT_SWITCH);
-}
-
-bool Symbol::isSimpleSwitch() const {
-    if(isRightSwitch()) {
-        return true;
-    }
-    if(isLeftSwitch()) {
-        return true;
-    }
-    return false;
-}
-
-bool Symbol::isThreeWaySwitch() const {
-    return check(8, SymbolType::THREE_WAY_SWITCH);
-}
-
-bool Symbol::isSwitch() const {
-    if(isCrossOverSwitch()) {
-        return true;
-    }
-    if(isSimpleSwitch()) {
-        return true;
-    }
-    if(isThreeWaySwitch()) {
-        return true;
-    }
-    return false;
-}
-
-bool Symbol::isValidSymbol() const {
-    if(isTrack()) {
-        return true;
-    }
-    if(isSwitch()) {
-        return true;
-    }
-    return false;
-}
-
-std::uint8_t Symbol::getJunctionsCount() const {
-    return countJunctions(symbolFix);
-}
-
-std::uint8_t Symbol::getOpenJunctionsCount() const {
-    return countJunctions(symbolDyn);
-}
-
 Direction Symbol::getNextJunction(Direction start) const {
     return nextJunction(symbolFix, start);
 }
@@ -221,16 +127,13 @@ bool Symbol::removeJunction(Direction dir) {
      return true;
 }
 
-std::uint8_t Symbol::countJunctions(std::uint8_t symbol) const {
-    std::uint8_t counter = 0;
-    auto b = static_cast<std::uint8_t>(Direction::TOP);
-    for(std::uint8_t i = 0; i < 8; ++i) {
-        if(symbol & b) {
-            ++counter;
-        }
-        b <<= 1;
+bool Symbol::addJunction(Direction dir) {
+    const auto junction = static_cast<std::uint8_t>(dir);
+    if(!(symbolFix & junction) || (symbolDyn & junction)) {
+        return false;
     }
-    return counter;
+    symbolDyn |= junction;
+    return true;
 }
 
 Direction Symbol::nextJunction(std::uint8_t symbol, Direction start) const {
@@ -20,7 +20,10 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <stdexcept>
+
 #include "direction.h"
 
 class Symbol {
@@ -36,16 +39,38 @@ public:
         BEND              = Direction::TOP | Direction::BOTTOM_LEFT,
     };
 
-    explicit Symbol(std::uint8_t symbol = 0);
+    /**
+     * Vorberechnete Klassifikation eines Bitmusters (siehe symbolTable)
+     */
+    struct Info {
+        std::uint8_t type;      // kanonisches Muster (SymbolType), 0 bei ungültigem Muster
+        std::uint8_t distance;  // Anzahl Rechtsrotationen vom kanonischen Muster zu diesem Muster
+        std::uint8_t period;    // Anzahl Rotationen, nach denen sich das Muster wiederholt
+        std::uint8_t junctions; // Anzahl der gesetzten Verbindungspunkte
+    };
+
+    constexpr explicit Symbol(std::uint8_t symbol = 0);
 
-    explicit Symbol(SymbolType symbol);
+    constexpr explicit Symbol(SymbolType symbol);
 
-    virtual ~Symbol() noexcept = default;
+    constexpr virtual ~Symbol() noexcept {
+    }
 
-    [[nodiscard]] std::uint8_t getType() const {
+    [[nodiscard]] constexpr std::uint8_t getType() const {
         return symbolFix;
     }
 
+    /**
+     * Liefert das kanonische Muster (SymbolType) des Symbols oder 0, wenn
+     * kein gültiges Symbol gesetzt ist
+     */
+    [[nodiscard]] constexpr std::uint8_t getBaseType() const;
+
+    /**
+     * Liefert die Klassifikation eines beliebigen Bitmusters
+     */
+    [[nodiscard]] static constexpr Info getInfo(std::uint8_t symbol);
+
     /**
      * rotiert ein Symbol mit "Überschlag" nach links. D.h. das letzte gesetzte Bit
      * rotiert wieder zum Anfang.
@@ -70,7 +95,7 @@ public:
     /**
      * Prüft, ob ein Symbol gesetzt ist
      */
-    [[nodiscard]] bool isSymbol() const;
+    [[nodiscard]] constexpr bool isSymbol() const;
 
     /**
      * Prüft, ob ein Symbol auf der linken oberen Seite Anschlüsse hat
@@ -80,62 +105,62 @@ public:
     /**
      * Prüft, ob das Symbol ein Endsymbol (Prellbock) ist
      */
-    [[nodiscard]] bool isEnd() const;
+    [[nodiscard]] constexpr bool isEnd() const;
 
     /**
      * Prüft, ob das Symbol ein gerades Gleis ist
      */
-    [[nodiscard]] bool isStraight() const;
+    [[nodiscard]] constexpr bool isStraight() const;
 
     /**
      * Prüft, ob das Symobl eine einfache Kreuzung ist
      */
-    [[nodiscard]] bool isCrossOver() const;
+    [[nodiscard]] constexpr bool isCrossOver() const;
 
     /**
      * Prüft, ob das Symbol gebogen ist
      */
-    [[nodiscard]] bool isBend() const;
+    [[nodiscard]] constexpr bool isBend() const;
 
     /**
      * Prüft, ob das Symbol ein einfaches Gleis ist (keine Weiche ...)
      */
-    [[nodiscard]] bool isTrack() const;
+    [[nodiscard]] constexpr bool isTrack() const;
 
     /**
      * Prüft, ob das Symob eine Doppelte Kreuzungsweiche ist
      */
-    [[nodiscard]] bool isCrossOverSwitch() const;
+    [[nodiscard]] constexpr bool isCrossOverSwitch() const;
 
     /**
      * Prüft, ob Symbol eine Linksweiche ist
      */
-    [[nodiscard]] bool isLeftSwitch() const;
+    [[nodiscard]] constexpr bool isLeftSwitch() const;
 
     /**
      * Prüft, ob Symbol eine Rechtsweiche ist
      */
-    [[nodiscard]] bool isRightSwitch() const;
+    [[nodiscard]] constexpr bool isRightSwitch() const;
 
     /**
      * Prüft, ob Symbol eine Weiche ist
      */
-    [[nodiscard]] bool isSimpleSwitch() const;
+    [[nodiscard]] constexpr bool isSimpleSwitch() const;
 
     /**
      * Prüft, ob Symbol eine Dreiwegweiche ist
      */
-    [[nodiscard]] bool isThreeWaySwitch() const;
+    [[nodiscard]] constexpr bool isThreeWaySwitch() const;
 
     /**
      * Prüft, ob Symbol kein einfaches Gleis ist
      */
-    [[nodiscard]] bool isSwitch() const;
+    [[nodiscard]] constexpr bool isSwitch() const;
 
     /**
      * Prüft, ob Symbol ein gültiges Symbol ist
      */
-    [[nodiscard]] bool isValidSymbol() const;
+    [[nodiscard]] constexpr bool isValidSymbol() const;
 
     [[nodiscard]] bool isJunctionSet(Direction d) const;
     bool areJunctionsSet(std::uint8_t junctions) const;
@@ -143,8 +168,8 @@ public:
     bool isOpenJunctionSet(Direction dir) const;
     bool areOpenJunctionsSet(std::uint8_t junctions) const;
 
-    std::uint8_t getJunctionsCount() const;
-    std::uint8_t getOpenJunctionsCount() const;
+    constexpr std::uint8_t getJunctionsCount() const;
+    constexpr std::uint8_t getOpenJunctionsCount() const;
 
     Direction getNextJunction(Direction start = Direction::TOP_LEFT) const;
     [[nodiscard]] Direction getNextOpenJunction(Direction start = Direction::TOP_LEFT) const;
@@ -153,6 +178,11 @@ public:
 
     bool removeJunction(Direction curDir);
 
+    /**
+     * Gibt einen zuvor mit removeJunction entfernten Verbindungspunkt wieder frei
+     */
+    bool addJunction(Direction dir);
+
     explicit operator bool() const;
 
     [[nodiscard]] bool hasOpenJunctionsLeft() const;
@@ -180,10 +210,186 @@ protected:
     /**
      * Gibt die Anzahl der Verbindungspunkte zurück
      */
-    std::uint8_t countJunctions(std::uint8_t symbol) const;
+    constexpr std::uint8_t countJunctions(std::uint8_t symbol) const;
 
     /**
      * Gibt die nächste offene Verbindung zurück
      */
     Direction nextJunction(std::uint8_t symbol, Direction start = Direction::TOP) const;
 };
+
+/**
+ * Klassifikation aller 256 möglichen Bitmuster. Jedes kanonische Muster wird so oft
+ * rotiert, bis es sich wiederholt; jede dabei entstehende Lage erhält den Typ und die
+ * Anzahl der Rotationen (wie von Symbol::getDistance geliefert). Alle übrigen Muster
+ * bleiben ungültig (type == 0).
+ */
+inline constexpr std::array<Symbol::Info, 256> symbolTable = [] {
+    constexpr std::uint8_t types[] = {
+        Symbol::END, Symbol::STRAIGHT, Symbol::RIGHT_SWITCH, Symbol::CROSS_OVER_SWITCH,
+        Symbol::LEFT_SWITCH, Symbol::THREE_WAY_SWITCH, Symbol::CROSS_OVER, Symbol::BEND
+    };
+
+    std::array<Symbol::Info, 256> table{};
+
+    for(unsigned int i = 0; i < 256; ++i) {
+        std::uint8_t junctions = 0;
+        for(unsigned int b = i; b; b >>= 1) {
+            junctions += b & 1;
+        }
+        table[i].junctions = junctions;
+    }
+
+    for(const auto type: types) {
+        std::uint8_t period = 1;
+        while(static_cast<std::uint8_t>(type << period | type >> (8 - period)) != type) {
+            ++period;
+        }
+        auto b = type;
+        for(std::uint8_t i = 0; i < period; ++i) {
+            table[b].type = type;
+            table[b].distance = i;
+            table[b].period = period;
+            b = (b << 1) | (b >> 7);
+        }
+    }
+    return table;
+}();
+
+constexpr Symbol::Symbol(std::uint8_t symbol): symbolFix{symbol}, symbolDyn{symbol} {
+    if(isSymbol() && !isValidSymbol()) {
+        throw std::invalid_argument("invalid symbol given");
+    }
+}
+
+constexpr Symbol::Symbol(Symbol::SymbolType symbol):
+symbolFix{static_cast<std::uint8_t>(symbol)}, symbolDyn{static_cast<std::uint8_t>(symbol)} {
+}
+
+constexpr Symbol::Info Symbol::getInfo(std::uint8_t symbol) {
+    return symbolTable[symbol];
+}
+
+constexpr std::uint8_t Symbol::getBaseType() const {
+    return symbolTable[symbolFix].type;
+}
+
+constexpr bool Symbol::isSymbol() const {
+    return symbolFix != 0;
+}
+
+constexpr bool Symbol::isEnd() const {
+    return getBaseType() == SymbolType::END;
+}
+
+constexpr bool Symbol::isStraight() const {
+    return getBaseType() == SymbolType::STRAIGHT;
+}
+
+constexpr bool Symbol::isCrossOver() const {
+    return getBaseType() == SymbolType::CROSS_OVER;
+}
+
+constexpr bool Symbol::isBend() const {
+    return getBaseType() == SymbolType::BEND;
+}
+
+constexpr bool Symbol::isTrack() const {
+    switch(getBaseType()) {
+        case SymbolType::STRAIGHT:
+        case SymbolType::CROSS_OVER:
+        case SymbolType::BEND:
+        case SymbolType::END:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+constexpr bool Symbol::isCrossOverSwitch() const {
+    return getBaseType() == SymbolType::CROSS_OVER_SWITCH;
+}
+
+constexpr bool Symbol::isLeftSwitch() const {
+    return getBaseType() == SymbolType::LEFT_SWITCH;
+}
+
+constexpr bool Symbol::isRightSwitch() const {
+    return getBaseType() == SymbolType::RIGHT_SWITCH;
+}
+
+constexpr bool Symbol::isSimpleSwitch() const {
+    return isLeftSwitch() || isRightSwitch();
+}
+
+constexpr bool Symbol::isThreeWaySwitch() const {
+    return getBaseType() == SymbolType::THREE_WAY_SWITCH;
+}
+
+constexpr bool Symbol::isSwitch() const {
+    switch(getBaseType()) {
+        case SymbolType::CROSS_OVER_SWITCH:
+        case SymbolType::LEFT_SWITCH:
+        case SymbolType::RIGHT_SWITCH:
+        case SymbolType::THREE_WAY_SWITCH:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+constexpr bool Symbol::isValidSymbol() const {
+    return getBaseType() != 0;
+}
+
+constexpr std::uint8_t Symbol::getJunctionsCount() const {
+    return countJunctions(symbolFix);
+}
+
+constexpr std::uint8_t Symbol::getOpenJunctionsCount() const {
+    return countJunctions(symbolDyn);
+}
+
+constexpr std::uint8_t Symbol::countJunctions(std::uint8_t symbol) const {
+    return symbolTable[symbol].junctions;
+}
+
+// Gegenprobe der Tabelle gegen die ursprüngliche Rotationsschleife (Symbol::check)
+static_assert([] {
+    constexpr struct {
+        std::uint8_t type;
+        std::uint8_t iterations;
+    } checks[] = {
+        {Symbol::END, 8}, {Symbol::STRAIGHT, 4}, {Symbol::CROSS_OVER, 2}, {Symbol::BEND, 8},
+        {Symbol::CROSS_OVER_SWITCH, 4}, {Symbol::LEFT_SWITCH, 8}, {Symbol::RIGHT_SWITCH, 8},
+        {Symbol::THREE_WAY_SWITCH, 8}
+    };
+
+    for(unsigned int i = 0; i < 256; ++i) {
+        std::uint8_t type = 0;
+        std::uint8_t distance = 0;
+        for(const auto &check: checks) {
+            auto b = check.type;
+            for(std::uint8_t j = 0; j < check.iterations; ++j) {
+                if(b == i) {
+                    type = check.type;
+                    distance = j;
+                    break;
+                }
+                b = (b << 1) | (b >> 7);
+            }
+        }
+        if(symbolTable[i].type != type || symbolTable[i].distance != distance) {
+            return false;
+        }
+    }
+    return true;
+}(), "symbolTable does not match Symbol::check");
+
+static_assert(Symbol{Symbol::STRAIGHT}.isTrack() && !Symbol{Symbol::STRAIGHT}.isSwitch());
+static_assert(Symbol{Symbol::THREE_WAY_SWITCH}.isSwitch() && Symbol{Symbol::THREE_WAY_SWITCH}.getJunctionsCount() == 4);
+static_assert(Symbol{Direction::LEFT | Direction::RIGHT}.isStraight());
+static_assert(Symbol::getInfo(Direction::LEFT | Direction::RIGHT).distance == 2);
+static_assert(!Symbol{}.isSymbol() && !Symbol{}.isValidSymbol());
@@ -0,0 +1,179 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#include "symbolclassifier.h"
+#include "symbol.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MOBA_SYMBOL_CLASSIFIER_X86
+#endif
+
+namespace {
+
+    // kanonisches Muster aller 256 Bitmuster; 16 Zeilen à 16 Einträge für pshufb
+    alignas(64) constexpr std::array<std::uint8_t, 256> symbolTypes = [] {
+        std::array<std::uint8_t, 256> types{};
+        for(unsigned int i = 0; i < 256; ++i) {
+            types[i] = symbolTable[i].type;
+        }
+        return types;
+    }();
+
+    std::size_t classifyScalar(
+        const std::uint8_t *symbols, std::uint8_t *types, std::uint64_t *validity, std::size_t begin, std::size_t end
+    ) {
+        std::size_t invalid = 0;
+        for(auto i = begin; i < end; ++i) {
+            const auto type = symbolTypes[symbols[i]];
+            types[i] = type;
+            if(type || !symbols[i]) {
+                validity[i / 64] |= std::uint64_t{1} << (i % 64);
+            } else {
+                ++invalid;
+            }
+        }
+        return invalid;
+    }
+
+#ifdef MOBA_SYMBOL_CLASSIFIER_X86
+
+    /*
+     * Die 256er-Tabelle wird in 16 Zeilen à 16 Bytes zerlegt. Das untere Nibble adressiert
+     * per pshufb den Eintrag innerhalb der Zeile, das obere Nibble wählt die Zeile aus.
+     */
+    __attribute__((target("avx2")))
+    std::size_t classifyAvx2(
+        const std::uint8_t *symbols, std::uint8_t *types, std::uint64_t *validity, std::size_t count
+    ) {
+        const auto nibble = _mm256_set1_epi8(0x0F);
+        const auto zero = _mm256_setzero_si256();
+
+        __m256i rows[16];
+        for(int h = 0; h < 16; ++h) {
+            rows[h] = _mm256_broadcastsi128_si256(
+                _mm_load_si128(reinterpret_cast<const __m128i*>(symbolTypes.data() + h * 16))
+            );
+        }
+
+        std::size_t invalid = 0;
+        std::size_t i = 0;
+        for(; i + 32 <= count; i += 32) {
+            const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(symbols + i));
+            const auto lo = _mm256_and_si256(v, nibble);
+            const auto hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+
+            auto type = zero;
+            for(int h = 0; h < 16; ++h) {
+                const auto sel = _mm256_cmpeq_epi8(hi, _mm256_set1_epi8(static_cast<char>(h)));
+                type = _mm256_blendv_epi8(type, _mm256_shuffle_epi8(rows[h], lo), sel);
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(types + i), type);
+
+            const auto bad = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, zero), _mm256_cmpeq_epi8(type, zero));
+            const auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(bad));
+            validity[i / 64] |= std::uint64_t{~mask} << (i % 64);
+            invalid += std::popcount(mask);
+        }
+        return invalid + classifyScalar(symbols, types, validity, i, count);
+    }
+
+    __attribute__((target("sse4.1")))
+    std::size_t classifySse4(
+        const std::uint8_t *symbols, std::uint8_t *types, std::uint64_t *validity, std::size_t count
+    ) {
+        const auto nibble = _mm_set1_epi8(0x0F);
+        const auto zero = _mm_setzero_si128();
+
+        std::size_t invalid = 0;
+        std::size_t i = 0;
+        for(; i + 16 <= count; i += 16) {
+            const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(symbols + i));
+            const auto lo = _mm_and_si128(v, nibble);
+            const auto hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+
+            auto type = zero;
+            for(int h = 0; h < 16; ++h) {
+                const auto row = _mm_load_si128(reinterpret_cast<const __m128i*>(symbolTypes.data() + h * 16));
+                const auto sel = _mm_cmpeq_epi8(hi, _mm_set1_epi8(static_cast<char>(h)));
+                type = _mm_blendv_epi8(type, _mm_shuffle_epi8(row, lo), sel);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(types + i), type);
+
+            const auto bad = _mm_andnot_si128(_mm_cmpeq_epi8(v, zero), _mm_cmpeq_epi8(type, zero));
+            const auto mask = static_cast<std::uint16_t>(_mm_movemask_epi8(bad));
+            validity[i / 64] |= std::uint64_t{static_cast<std::uint16_t>(~mask)} << (i % 64);
+            invalid += std::popcount(mask);
+        }
+        return invalid + classifyScalar(symbols, types, validity, i, count);
+    }
+
+#endif
+}
+
+std::size_t classifySymbols(
+    std::span<const std::uint8_t> symbols, std::span<std::uint8_t> types, std::span<std::uint64_t> validity
+) {
+    const auto count = symbols.size();
+
+    if(types.size() < count || validity.size() < (count + 63) / 64) {
+        throw std::invalid_argument{"output buffer too small"};
+    }
+    std::fill_n(validity.begin(), (count + 63) / 64, 0);
+
+#ifdef MOBA_SYMBOL_CLASSIFIER_X86
+    if(__builtin_cpu_supports("avx2")) {
+        return classifyAvx2(symbols.data(), types.data(), validity.data(), count);
+    }
+    if(__builtin_cpu_supports("sse4.1")) {
+        return classifySse4(symbols.data(), types.data(), validity.data(), count);
+    }
+#endif
+    return classifyScalar(symbols.data(), types.data(), validity.data(), 0, count);
+}
+
+SymbolClassification classifySymbols(std::span<const std::uint8_t> symbols) {
+    SymbolClassification result;
+    result.types.resize(symbols.size());
+    result.validity.resize((symbols.size() + 63) / 64);
+    result.invalidCount = classifySymbols(symbols, result.types, result.validity);
+    return result;
+}
+
+std::vector<std::size_t> SymbolClassification::getInvalidCells() const {
+    std::vector<std::size_t> cells;
+    cells.reserve(invalidCount);
+
+    for(std::size_t w = 0; w < validity.size(); ++w) {
+        auto bits = ~validity[w];
+        if(w == validity.size() - 1 && types.size() % 64) {
+            bits &= (std::uint64_t{1} << (types.size() % 64)) - 1;
+        }
+        while(bits) {
+            cells.push_back(w * 64 + std::countr_zero(bits));
+            bits &= bits - 1;
+        }
+    }
+    return cells;
+}
@@ -0,0 +1,61 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2019 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * Ergebnis einer Massenklassifikation von rohen Symbol-Bytes
+ */
+struct SymbolClassification {
+    std::vector<std::uint8_t> types;     // kanonisches Muster je Zelle (Symbol::getBaseType)
+    std::vector<std::uint64_t> validity; // Bit gesetzt -> Zelle ist gültig (leere Zellen sind gültig)
+    std::size_t invalidCount = 0;
+
+    [[nodiscard]] bool isValid(std::size_t idx) const {
+        return validity[idx / 64] >> (idx % 64) & 1;
+    }
+
+    /**
+     * Liefert die Indizes sämtlicher ungültiger Zellen in aufsteigender Reihenfolge
+     */
+    [[nodiscard]] std::vector<std::size_t> getInvalidCells() const;
+};
+
+/**
+ * Klassifiziert einen zusammenhängenden Block roher Symbol-Bytes in einem Durchlauf.
+ * Anders als der Konstruktor von Symbol wird bei ungültigen Mustern keine Exception
+ * geworfen, sondern das entsprechende Bit in der Gültigkeits-Bitmap gelöscht. Je nach
+ * CPU wird ein AVX2-, SSE4.1- oder skalarer Kernel verwendet.
+ *
+ * @param symbols rohe Symbol-Bytes
+ * @param types Ziel für das kanonische Muster je Zelle, mindestens symbols.size() groß
+ * @param validity Ziel für die Gültigkeits-Bitmap, mindestens (symbols.size() + 63) / 64 Worte groß
+ * @return std::size_t Anzahl der ungültigen Zellen
+ */
+std::size_t classifySymbols(
+    std::span<const std::uint8_t> symbols, std::span<std::uint8_t> types, std::span<std::uint64_t> validity
+);
+
+SymbolClassification classifySymbols(std::span<const std::uint8_t> symbols);
@@ -0,0 +1,266 @@
+/*
+ *  Project:    moba-lib-tracklayout
+ *
+ *  Copyright (C) 2023 Stefan Paproth <pappi-@gmx.de>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/agpl.txt>.
+ *
+ */
+
+/*
+ * Belastungstest für das Stellen von Weichen während laufender Fahrwegabfragen. Wird mit
+ * -fsanitize=thread übersetzt (siehe CMakeLists.txt): Jeder Datenwettlauf zwischen turn /
+ * compareAndTurn und getJunctionNode, findNext bzw. den Adaptern führt zum Abbruch.
+ * Zusätzlich wird geprüft, dass jede Abfrage einen der möglichen Nachbarn liefert und
+ * dass keine compareAndTurn-Stellung verloren geht.
+ *
+ * Aufruf: test-nodestress [Runden]
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "moba/node_block.h"
+#include "moba/node_crossoverswitch.h"
+#include "moba/node_simpleswitch.h"
+#include "moba/node_threewayswitch.h"
+#include "moba/nodegraph.h"
+
+namespace {
+
+    constexpr std::array<moba::SwitchStand, 4> stands{
+        moba::SwitchStand::BEND_1, moba::SwitchStand::BEND_2,
+        moba::SwitchStand::STRAIGHT_1, moba::SwitchStand::STRAIGHT_2
+    };
+
+    constexpr unsigned int writersCount = 2;
+    constexpr unsigned int readersCount = 3;
+
+    std::atomic<long> errors{0};
+
+    void check(bool condition, const char *what) {
+        if(!condition && errors.fetch_add(1, std::memory_order_relaxed) == 0) {
+            std::cerr << "check failed: " << what << std::endl;
+        }
+    }
+
+    moba::SwitchStand getNextStand(moba::SwitchStand stand) {
+        return stands[(getStateRow(stand) + 1) % stands.size()];
+    }
+
+    /**
+     * Startet writersCount Schreiber und readersCount Leser; die Leser laufen, bis alle
+     * Schreiber fertig sind
+     */
+    void run(const std::function<void(unsigned int)> &writer, const std::function<void()> &reader) {
+        std::atomic<unsigned int> running{writersCount};
+        std::vector<std::jthread> threads;
+
+        for(unsigned int i = 0; i < writersCount; ++i) {
+            threads.emplace_back([&, i] {
+                writer(i);
+                running.fetch_sub(1, std::memory_order_release);
+            });
+        }
+        for(unsigned int i = 0; i < readersCount; ++i) {
+            threads.emplace_back([&] {
+                do {
+                    reader();
+                } while(running.load(std::memory_order_acquire));
+            });
+        }
+    }
+
+    /**
+     * Zählt erfolgreiche compareAndTurn-Schritte im Kreis BEND_1 -> ... -> STRAIGHT_2;
+     * die Endstellung muss genau der Startstellung plus der Anzahl der Erfolge entsprechen
+     */
+    template<typename Get, typename CompareAndTurn>
+    void checkCompareAndTurn(unsigned int rounds, Get get, CompareAndTurn compareAndTurn) {
+        const auto start = getStateRow(get());
+        std::atomic<unsigned long> turned{0};
+        {
+            std::vector<std::jthread> threads;
+            for(unsigned int i = 0; i < writersCount + readersCount; ++i) {
+                threads.emplace_back([&] {
+                    for(unsigned int r = 0; r < rounds; ++r) {
+                        const auto stand = get();
+                        if(compareAndTurn(stand, getNextStand(stand))) {
+                            turned.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    }
+                });
+            }
+        }
+        check(get() == stands[(start + turned.load()) % stands.size()], "compareAndTurn lost an update");
+    }
+
+    void stressNodes(unsigned int rounds) {
+        auto a = std::make_shared<Block>(1);
+        auto b = std::make_shared<Block>(2);
+        auto c = std::make_shared<Block>(3);
+        auto d = std::make_shared<Block>(4);
+
+        auto simple = std::make_shared<SimpleSwitch>(10);
+        simple->setJunctionNode(Direction::BOTTOM, a);
+        simple->setJunctionNode(Direction::TOP, b);
+        simple->setJunctionNode(Direction::TOP_LEFT, c);
+
+        auto threeWay = std::make_shared<ThreeWaySwitch>(11);
+        threeWay->setJunctionNode(Direction::BOTTOM, a);
+        threeWay->setJunctionNode(Direction::TOP, b);
+        threeWay->setJunctionNode(Direction::TOP_LEFT, c);
+        threeWay->setJunctionNode(Direction::TOP_RIGHT, d);
+
+        auto crossOver = std::make_shared<CrossOverSwitch>(12);
+        crossOver->setJunctionNode(Direction::BOTTOM, a);
+        crossOver->setJunctionNode(Direction::BOTTOM_LEFT, b);
+        crossOver->setJunctionNode(Direction::TOP, c);
+        crossOver->setJunctionNode(Direction::TOP_RIGHT, d);
+
+        const std::array<NodePtr, 3> switches{simple, threeWay, crossOver};
+
+        run([&](unsigned int writer) {
+            for(unsigned int r = 0; r < rounds; ++r) {
+                const auto &node = switches[(r + writer) % switches.size()];
+                if(r % 2) {
+                    node->turn(stands[(r * 3 + writer) % stands.size()]);
+                } else {
+                    const auto stand = node->getState();
+                    node->compareAndTurn(stand, getNextStand(stand));
+                }
+            }
+        }, [&] {
+            const auto next = simple->getJunctionNode(a);
+            check(next == b || next == c, "simple switch: unexpected exit");
+
+            const auto three = threeWay->getJunctionNode(a);
+            check(!three || three == b || three == c || three == d, "three-way switch: unexpected exit");
+
+            const auto cross = crossOver->findJunctionNode(a);
+            check(!cross || !*cross || *cross == c || *cross == d, "cross-over switch: unexpected exit");
+        });
+
+        checkCompareAndTurn(rounds, [&] {
+            return simple->getState();
+        }, [&](moba::SwitchStand expected, moba::SwitchStand desired) {
+            return simple->compareAndTurn(expected, desired);
+        });
+    }
+
+    /**
+     * Ring aus pairs Paaren Block / einfache Weiche; der abzweigende Strang jeder Weiche
+     * endet an einem Block, dessen anderer Anschluss offen ist
+     */
+    NodeGraph createRing(std::size_t pairs) {
+        NodeGraph graph;
+        for(std::size_t i = 0; i < pairs; ++i) {
+            graph.addNode(NodeKind::BLOCK, static_cast<unsigned int>(i * 3));
+            graph.addNode(NodeKind::SIMPLE_SWITCH, static_cast<unsigned int>(i * 3 + 1));
+            graph.addNode(NodeKind::BLOCK, static_cast<unsigned int>(i * 3 + 2));
+        }
+        for(std::size_t i = 0; i < pairs; ++i) {
+            const auto block = static_cast<NodeId>(i * 3);
+            const auto next = static_cast<NodeId>((i * 3 + 3) % (pairs * 3));
+
+            graph.connect(block, 1, block + 1, 0);
+            graph.connect(block + 1, 1, next, 0);
+            graph.connect(block + 1, 2, block + 2, 0);
+        }
+        return graph;
+    }
+
+    void stressGraph(unsigned int rounds) {
+        constexpr std::size_t pairs = 8;
+        constexpr unsigned int steps = 3 * pairs;
+
+        // Adapter werden nicht vorab geholt: auch getNode muss parallel sicher sein
+        NodeGraph graph = createRing(pairs);
+        const NodeGraph &view = graph;
+
+        run([&](unsigned int writer) {
+            for(unsigned int r = 0; r < rounds; ++r) {
+                const auto node = static_cast<NodeId>(((r + writer) % pairs) * 3 + 1);
+                const auto stand = stands[(r * 3 + writer) % stands.size()];
+                switch(r % 3) {
+                    case 0:
+                        graph.turn(node, stand);
+                        break;
+
+                    case 1:
+                        graph.getNode(node)->turn(stand);
+                        break;
+
+                    default:
+                        graph.compareAndTurn(node, graph.getState(node), stand);
+                        break;
+                }
+            }
+        }, [&] {
+            // Arena: jeder Schritt führt zum nächsten Knoten oder endet am Abzweig
+            NodeGraph::Step cur{0, 0};
+            for(unsigned int i = 0; i < steps; ++i) {
+                const auto next = view.findNext(cur.node, cur.entry);
+                if(!next) {
+                    check(cur.node % 3 == 2, "arena: stuck outside a branch end");
+                    cur = {0, 0};
+                    continue;
+                }
+                cur = *next;
+            }
+
+            // Adapter: dieselbe Fahrt über das Node-Interface
+            auto prev = view.getNode(static_cast<NodeId>((pairs - 1) * 3 + 1));
+            auto node = view.getNode(0);
+            for(unsigned int i = 0; i < steps; ++i) {
+                auto next = node->findJunctionNode(prev);
+                check(next.has_value(), "adapter: previous node is not a neighbour");
+                if(!next || !*next) {
+                    prev = view.getNode(static_cast<NodeId>((pairs - 1) * 3 + 1));
+                    node = view.getNode(0);
+                    continue;
+                }
+                prev = std::move(node);
+                node = std::move(*next);
+            }
+        });
+
+        const auto node = static_cast<NodeId>(1);
+        checkCompareAndTurn(rounds, [&] {
+            return graph.getState(node);
+        }, [&](moba::SwitchStand expected, moba::SwitchStand desired) {
+            return graph.getNode(node)->compareAndTurn(expected, desired);
+        });
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const auto rounds = argc > 1 ? static_cast<unsigned int>(std::strtoul(argv[1], nullptr, 10)) : 20000u;
+
+    stressNodes(rounds);
+    stressGraph(rounds);
+
+    if(errors.load()) {
+        std::cerr << errors.load() << " checks failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "ok" << std::endl;
+    return EXIT_SUCCESS;
+}